@@ -115,6 +115,39 @@ from {input_relation}
 where word ilike '%database%';
 '''
 
+# The keywords of the keyword benchmarks. The few keywords are matched with
+# Teddy, the keywords from all topics of create_words.cpp with Aho-Corasick.
+KEYWORDS = ['database', 'mining', 'graph', 'privacy', 'stream', 'transaction', 'learning', 'cloud']
+TOPIC_KEYWORDS = KEYWORDS + [
+    'management', 'analytics', 'distributed', 'network', 'machine', 'scientific',
+    'social', 'temporal', 'access', 'control', 'hardware', 'query', 'performance',
+    'system', 'model', 'information', 'knowledge', 'language', 'provenance',
+    'warehousing', 'parallel', 'business', 'security', 'blockchain', 'engine',
+    'concurrency', 'recovery', 'accelerator', 'processing', 'optimization',
+    'storage', 'memory', 'indexing', 'search', 'benchmark', 'integration',
+    'quality', 'cleaning', 'metadata', 'semantic',
+]
+
+UDO_KEYWORDS_SQL = '''\
+select count(*)
+from match_keywords(table (select word from {input_relation}), '{keywords}');
+'''
+KEYWORDS_SQL = '''\
+select count(*)
+from {input_relation},
+    (values {keyword_values}) k(keyword)
+where word ilike '%' || keyword || '%';
+'''
+
+
+def format_keywords_queries(keywords):
+    """Get the UDO and the SQL query of the keyword benchmark for a list of
+    keywords. The input relation is still left to be formatted."""
+    udo_query = UDO_KEYWORDS_SQL.format(input_relation='{input_relation}', keywords=','.join(keywords))
+    keyword_values = ', '.join(f"('{keyword}')" for keyword in keywords)
+    sql_query = KEYWORDS_SQL.format(input_relation='{input_relation}', keyword_values=keyword_values)
+    return udo_query, sql_query
+
 UDO_ARRAYS_SQL =  '''\
 select name, count(*)
 from split_arrays(table (select name, values from {input_relation}))
@@ -202,6 +235,7 @@ UDO_FUNCTIONS = [
     ('create_words', 'bigint', 'CreateWords'),
     ('create_arrays', 'bigint', 'CreateArrays'),
     ('contains_database', 'table', 'ContainsDatabase'),
+    ('match_keywords', 'table, text', 'MatchKeywords'),
     ('split_arrays', 'table', 'SplitArrays'),
     ('udo_kmeans', 'table', 'KMeans'),
     ('udo_regression', 'table', 'LinearRegression'),
@@ -926,6 +960,10 @@ if __name__ == '__main__':
                 )
             run_words('udo_words', UDO_WORDS_SQL, 'o')
             run_words('words', WORDS_SQL, 'o')
+            for name, keywords in (('keywords', KEYWORDS), ('topic_keywords', TOPIC_KEYWORDS)):
+                udo_query, sql_query = format_keywords_queries(keywords)
+                run_words(f'udo_{name}', udo_query, 'o')
+                run_words(name, sql_query, 'o')
 
         if run_duckdb:
             run_duckdb_benchmark(
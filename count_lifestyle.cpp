@@ -2,6 +2,7 @@
 #include <atomic>
 #include <string_view>
 //---------------------------------------------------------------------------
+#include <udo/Columns.hpp>
 #include <udo/UDOperator.hpp>
 //---------------------------------------------------------------------------
 using namespace std;
@@ -22,6 +23,10 @@ class CountLifestyle : public udo::UDOperator<InputTuple, OutputTuple> {
    atomic_flag outputMutex;
 
    public:
+   /// The attributes of the input and output tuples for the standalone driver
+   using InputColumns = udo::Columns<&InputTuple::word>;
+   using OutputColumns = udo::Columns<&OutputTuple::word, &OutputTuple::wordCount>;
+
    void consume(LocalState& /*localState*/, const InputTuple& tuple) {
       if (tuple.word == "lifestyle"sv)
          lifestyle.fetch_add(1, memory_order_relaxed);
@@ -35,10 +40,14 @@ class CountLifestyle : public udo::UDOperator<InputTuple, OutputTuple> {
 
       array<OutputTuple, 2> result = {{{"lifestyle"sv, lifestyle.load()}, {"other"sv, other.load()}}};
 
-      for (auto& tuple : result)
-         produceOutputTuple(tuple);
+      produceOutputTuples(result);
 
       return true;
    }
 };
 //---------------------------------------------------------------------------
+#ifdef UDO_STANDALONE
+#include <udo/UDOExport.hpp>
+UDO_STANDALONE_EXPORT(CountLifestyle)
+#endif
+//---------------------------------------------------------------------------
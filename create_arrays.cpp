@@ -4,6 +4,7 @@
 #include <string>
 #include <string_view>
 //---------------------------------------------------------------------------
+#include <udo/Random.hpp>
 #include <udo/UDOperator.hpp>
 //---------------------------------------------------------------------------
 using namespace std;
@@ -57,34 +58,33 @@ class CreateArrays : public udo::UDOperator<udo::EmptyTuple, Output> {
       if (localTupleCount >= numTuples)
          return true;
 
-      uint64_t seed = 42 + localTupleCount;
-      mt19937_64 gen(seed);
-      uniform_int_distribution<size_t> nameIndexDistr(0, names.size() - 1);
-      uniform_int_distribution<size_t> invalidValueIndexDistr(0, invalidValues.size() - 1);
-      bernoulli_distribution hasValueDistr(0.9);
+      // Every morsel has its own random stream, so the tuples do not depend
+      // on the number of threads
+      udo::RandomGenerator gen(42, localTupleCount);
       binomial_distribution<unsigned> numValuesDistr(50, 0.2);
-      uniform_int_distribution<int> randomNumberDistr(0, 1000000);
 
+      // The values are built in one buffer and copied into the output
+      string values;
       for (uint64_t i = 0; i < 10000 && localTupleCount + i < numTuples; ++i) {
-         auto name = names[nameIndexDistr(gen)];
+         auto name = names[gen.nextBounded(names.size())];
 
-         string values;
+         values.clear();
          auto numValues = numValuesDistr(gen);
          for (unsigned j = 0; j < numValues; ++j) {
             if (j > 0)
                 values += ',';
-            if (hasValueDistr(gen)) {
-                auto value = randomNumberDistr(gen);
+            if (gen.nextDouble() < 0.9) {
+                auto value = gen.nextBounded(1000001);
                 values += to_string(value);
             } else {
-                auto value = invalidValues[invalidValueIndexDistr(gen)];
+                auto value = invalidValues[gen.nextBounded(invalidValues.size())];
                 values += value;
             }
          }
 
          Output output;
          output.name = name;
-         output.values = string_view(values);
+         output.values = makeOutputString(values);
 
          produceOutputTuple(output);
       }
@@ -1,9 +1,11 @@
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <cmath>
 #include <cstdint>
-#include <random>
+#include <span>
 //---------------------------------------------------------------------------
+#include <udo/Random.hpp>
 #include <udo/UDOperator.hpp>
 //---------------------------------------------------------------------------
 using namespace std;
@@ -65,35 +67,55 @@ class CreatePoints : public udo::UDOperator<udo::EmptyTuple, Output> {
       1.0 / 8,
    };
 
-   /// The number of points that should be generated
-   uint64_t numPoints;
-   /// The next cluster that should be generated
-   atomic<uint32_t> nextClusterId = 0;
+   /// The seed of the random numbers
+   static constexpr uint64_t seed = 42;
+   /// The number of points a thread generates at once
+   static constexpr uint64_t morselSize = 10000;
+   /// The number of points whose random numbers are generated together
+   static constexpr uint64_t batchSize = 256;
+
+   /// The index of the first point of every cluster, and the total number of
+   /// points at the end
+   array<uint64_t, clusterCenters.size() + 1> clusterBegins;
+   /// The next point that should be generated
+   atomic<uint64_t> nextPoint = 0;
 
    public:
    /// Constructor
-   explicit CreatePoints(uint64_t numPoints) : numPoints(numPoints) {}
+   explicit CreatePoints(uint64_t numPoints) {
+      clusterBegins[0] = 0;
+      for (size_t i = 0; i < clusterCenters.size(); ++i)
+         clusterBegins[i + 1] = clusterBegins[i] + static_cast<uint64_t>(ceil(numPoints * clusterPointsProportions[i]));
+   }
 
    /// Produce the output
    bool postProduce(LocalState& /*localState*/) {
-      auto clusterId = nextClusterId.fetch_add(1);
-      if (clusterId >= clusterCenters.size())
+      auto firstPoint = nextPoint.fetch_add(morselSize);
+      auto numPoints = clusterBegins.back();
+      if (firstPoint >= numPoints)
          return true;
 
-      uint64_t seed = 42 + clusterId;
-      mt19937_64 gen(seed);
+      // Every morsel has its own random stream, so the points do not depend
+      // on the number of threads
+      udo::RandomGenerator gen(seed, firstPoint);
 
-      normal_distribution xDist(clusterCenters[clusterId].x, stdDevs[clusterId]);
-      normal_distribution yDist(clusterCenters[clusterId].y, stdDevs[clusterId]);
+      auto morselEnd = min(firstPoint + morselSize, numPoints);
+      uint32_t clusterId = upper_bound(clusterBegins.begin(), clusterBegins.end(), firstPoint) - clusterBegins.begin() - 1;
+      for (auto batchBegin = firstPoint; batchBegin < morselEnd;) {
+         // Batches do not cross clusters
+         while (clusterBegins[clusterId + 1] <= batchBegin)
+            ++clusterId;
+         auto size = min({batchSize, morselEnd - batchBegin, clusterBegins[clusterId + 1] - batchBegin});
 
-      uint64_t numClusterPoints = ceil(numPoints * clusterPointsProportions[clusterId]);
+         array<double, batchSize> xs, ys;
+         gen.fillNormal(span(xs).first(size), clusterCenters[clusterId].x, stdDevs[clusterId]);
+         gen.fillNormal(span(ys).first(size), clusterCenters[clusterId].y, stdDevs[clusterId]);
 
-      for (uint64_t i = 0; i < numClusterPoints; ++i) {
-         Output output;
-         output.x = xDist(gen);
-         output.y = yDist(gen);
-         output.clusterId = clusterId;
-         produceOutputTuple(output);
+         array<Output, batchSize> outputs;
+         for (uint64_t i = 0; i < size; ++i)
+            outputs[i] = {xs[i], ys[i], clusterId};
+         produceOutputTuples(span<const Output>(outputs).first(size));
+         batchBegin += size;
       }
 
       return false;
@@ -1,6 +1,9 @@
+#include <algorithm>
+#include <array>
 #include <atomic>
-#include <random>
+#include <span>
 //---------------------------------------------------------------------------
+#include <udo/Random.hpp>
 #include <udo/UDOperator.hpp>
 //---------------------------------------------------------------------------
 using namespace std;
@@ -34,6 +37,13 @@ class CreateRegressionPoints : public udo::UDOperator<udo::EmptyTuple, Output> {
    /// The counter for the threads that generate the points
    atomic<uint64_t> pointsCounter = 0;
 
+   /// The seed of the random numbers
+   static constexpr uint64_t seed = 42;
+   /// The number of points a thread generates at once
+   static constexpr uint64_t morselSize = 10000;
+   /// The number of points whose random numbers are generated together
+   static constexpr uint64_t batchSize = 256;
+
    public:
    /// Constructor
    CreateRegressionPoints(double a, double b, double c, uint64_t numPoints)
@@ -41,22 +51,28 @@ class CreateRegressionPoints : public udo::UDOperator<udo::EmptyTuple, Output> {
 
    /// Produce the output
    bool postProduce(LocalState& /*localState*/) {
-      auto firstIndex = pointsCounter.fetch_add(10000);
+      auto firstIndex = pointsCounter.fetch_add(morselSize);
       if (firstIndex >= numPoints)
          return true;
 
-      uint64_t seed = 42 + firstIndex;
-      mt19937_64 gen(seed);
-
-      uniform_real_distribution xDist(0.0, 100.0);
+      // Every morsel has its own random stream, so the points do not depend
+      // on the number of threads
+      udo::RandomGenerator gen(seed, firstIndex);
       double stddev = a + b + c;
-      normal_distribution eDist(0.0, stddev);
 
-      for (uint64_t i = 0; i < 10000 && firstIndex + i < numPoints; ++i) {
-         double x = xDist(gen);
-         double e = eDist(gen);
-         double y = a + b * x + c * x * x + e;
-         produceOutputTuple({x, y});
+      auto morselEnd = min(firstIndex + morselSize, numPoints);
+      for (auto batchBegin = firstIndex; batchBegin < morselEnd; batchBegin += batchSize) {
+         auto size = min(batchSize, morselEnd - batchBegin);
+         array<double, batchSize> xs, es;
+         gen.fillUniform(span(xs).first(size), 0.0, 100.0);
+         gen.fillNormal(span(es).first(size), 0.0, stddev);
+
+         array<Output, batchSize> outputs;
+         for (uint64_t i = 0; i < size; ++i) {
+            double x = xs[i];
+            outputs[i] = {x, a + b * x + c * x * x + es[i]};
+         }
+         produceOutputTuples(span<const Output>(outputs).first(size));
       }
 
       return false;
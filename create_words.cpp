@@ -1,9 +1,9 @@
 #include <array>
 #include <atomic>
-#include <random>
 #include <string>
 #include <string_view>
 //---------------------------------------------------------------------------
+#include <udo/Random.hpp>
 #include <udo/UDOperator.hpp>
 //---------------------------------------------------------------------------
 using namespace std;
@@ -95,23 +95,24 @@ class CreateWords : public udo::UDOperator<udo::EmptyTuple, Output> {
       if (localWordCount >= numWords)
          return true;
 
-      uint64_t seed = 42 + localWordCount;
-      mt19937_64 gen(seed);
-      uniform_int_distribution<size_t> wordIndexDistr(0, words.size() - 1);
-      uniform_int_distribution<uint32_t> randomNumberDistr;
+      // Every morsel has its own random stream, so the words do not depend
+      // on the number of threads
+      udo::RandomGenerator gen(42, localWordCount);
 
+      // The words are built in one buffer and copied into the output
+      string word;
       for (uint64_t i = 0; i < 10000 && localWordCount + i < numWords; ++i) {
-         auto baseWord = words[wordIndexDistr(gen)];
+         auto baseWord = words[gen.nextBounded(words.size())];
          // Add a random number as prefix and suffix to the string so that it's
          // not just a bunch of identical strings.
-         string word = to_string(randomNumberDistr(gen));
+         word = to_string(static_cast<uint32_t>(gen() >> 32));
          word += ' ';
          word += baseWord;
          word += ' ';
-         word += to_string(randomNumberDistr(gen));
+         word += to_string(static_cast<uint32_t>(gen() >> 32));
 
          Output output;
-         output.word = string_view(word);
+         output.word = makeOutputString(word);
 
          produceOutputTuple(output);
       }
@@ -0,0 +1,94 @@
+#!/bin/bash
+
+# Compile a UDO with docker_compile_standalone.sh and cache the result. The
+# cache key is a hash of the preprocessed source, which includes the runtime
+# headers, the compiler version, the target CPU and all flags, so a warm
+# compilation only copies the cached binary. With --report, a line
+#     <output>,<cold|warm>,<milliseconds>
+# is printed for every compilation.
+
+set -eu
+
+if (( $# < 1 )); then
+    echo "Usage: $0 [--report] <arguments for docker_compile_standalone.sh>..."
+    exit 2
+fi
+
+script_dir="$(readlink -f "$(dirname "${BASH_SOURCE[0]}")")"
+compile="${UDO_COMPILE:-$script_dir/docker_compile_standalone.sh}"
+cache_dir="${UDO_CACHE_DIR:-${XDG_CACHE_HOME:-$HOME/.cache}/udo}"
+
+report=0
+if [[ "$1" == "--report" ]]; then
+    report=1
+    shift
+fi
+
+# Separate the output file from the other arguments
+output=""
+args=()
+while (( $# > 0 )); do
+    if [[ "$1" == "-o" ]]; then
+        output="$2"
+        shift 2
+    else
+        args+=("$1")
+        shift
+    fi
+done
+if [[ -z "$output" ]]; then
+    echo "$0: an output file is required (-o <file>)"
+    exit 2
+fi
+
+start_ns="$(date +%s%N)"
+
+# The target CPU as resolved by the compiler for -march=native
+target_cpu="$("$compile" -### -E -x c++ /dev/null 2>&1 | grep -o -- '"-target-cpu" "[^"]*"\|"-target-feature" "[^"]*"' || true)"
+if [[ -z "$target_cpu" ]]; then
+    target_cpu="$(awk -F: '/^(model name|flags)/ { print; if (++n == 2) exit }' /proc/cpuinfo)"
+fi
+
+# Preprocess the source. The diagnostics are only shown when it fails, as
+# link flags cause warnings here. A failed run must not produce a key.
+preprocessed="$(mktemp)"
+diagnostics="$(mktemp)"
+trap 'rm -f "$preprocessed" "$diagnostics"' EXIT
+if ! "$compile" -E -P "${args[@]}" -o "$preprocessed" 2>"$diagnostics"; then
+    cat "$diagnostics" >&2
+    echo "$0: preprocessing failed" >&2
+    exit 1
+fi
+
+key="$(
+    {
+        cat "$preprocessed"
+        echo "--- compiler"
+        cat "$compile"
+        "$compile" --version 2>&1
+        echo "--- target"
+        echo "$target_cpu"
+        echo "--- flags"
+        printf '%s\n' "${args[@]}"
+    } | sha256sum | cut -d ' ' -f 1
+)"
+cached="$cache_dir/${key:0:2}/$key"
+
+status=warm
+if [[ ! -f "$cached" ]]; then
+    status=cold
+    mkdir -p "$(dirname "$cached")"
+    "$compile" "${args[@]}" -o "$output"
+    # Concurrent compilations of the same key replace the entry atomically
+    tmp="$(mktemp "$cached.XXXXXX")"
+    cp -p "$output" "$tmp"
+    mv -f "$tmp" "$cached"
+else
+    cp -p "$cached" "$output.tmp.$$"
+    mv -f "$output.tmp.$$" "$output"
+fi
+
+if (( report )); then
+    end_ns="$(date +%s%N)"
+    echo "$output,$status,$(( (end_ns - start_ns) / 1000000 ))"
+fi
@@ -1,4 +1,5 @@
 //---------------------------------------------------------------------------
+#include <udo/Columns.hpp>
 #include <udo/UDOperator.hpp>
 //---------------------------------------------------------------------------
 using namespace std;
@@ -9,8 +10,17 @@ struct Tuple {
 //---------------------------------------------------------------------------
 class Identity : public udo::UDOperator<Tuple, Tuple> {
    public:
+   /// The attributes of the input and output tuples for the standalone driver
+   using InputColumns = udo::Columns<&Tuple::a>;
+   using OutputColumns = udo::Columns<&Tuple::a>;
+
    void consume(LocalState& /*localState*/, const Tuple& input) {
       produceOutputTuple(input);
    }
 };
 //---------------------------------------------------------------------------
+#ifdef UDO_STANDALONE
+#include <udo/UDOExport.hpp>
+UDO_STANDALONE_EXPORT(Identity)
+#endif
+//---------------------------------------------------------------------------
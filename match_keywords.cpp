@@ -0,0 +1,84 @@
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+//---------------------------------------------------------------------------
+#include <udo/Columns.hpp>
+#include <udo/MultiStringSearch.hpp>
+#include <udo/UDOperator.hpp>
+#include <udo/WorkerStates.hpp>
+//---------------------------------------------------------------------------
+using namespace std;
+using namespace std::literals::string_view_literals;
+//---------------------------------------------------------------------------
+struct InputTuple {
+   udo::String word;
+};
+//---------------------------------------------------------------------------
+struct OutputTuple {
+   udo::String word;
+   uint64_t keywordId;
+};
+//---------------------------------------------------------------------------
+class MatchKeywords : public udo::UDOperator<InputTuple, OutputTuple> {
+   /// The keywords of the standalone driver
+   static constexpr string_view defaultKeywords = "database,mining,graph,privacy,stream,transaction,learning,cloud"sv;
+
+   /// The state of a worker
+   struct MatchState {
+      /// The number of the last tuple of the worker that matched every
+      /// keyword, to produce each keyword only once per tuple
+      vector<uint64_t> lastMatches;
+      /// The number of tuples of the worker
+      uint64_t numTuples = 0;
+   };
+
+   /// The keywords, separated by commas
+   string keywords;
+   /// The search for all keywords, case-insensitively
+   udo::CaseInsensitiveMultiSearch keywordSearch;
+   /// The states of the workers
+   udo::WorkerStates<MatchState> matchStates;
+
+   /// Split the keywords at the commas
+   static vector<string_view> splitKeywords(string_view keywords) {
+      vector<string_view> result;
+      while (true) {
+         auto end = keywords.find(',');
+         result.push_back(keywords.substr(0, end));
+         if (end == string_view::npos)
+            return result;
+         keywords.remove_prefix(end + 1);
+      }
+   }
+
+   public:
+   /// The attributes of the input and output tuples for the standalone driver
+   using InputColumns = udo::Columns<&InputTuple::word>;
+   using OutputColumns = udo::Columns<&OutputTuple::word, &OutputTuple::keywordId>;
+
+   /// Constructor with the default keywords, for the standalone driver
+   MatchKeywords() : MatchKeywords(defaultKeywords) {}
+   /// Constructor. The keywords are separated by commas and numbered from 0.
+   explicit MatchKeywords(udo::String keywords)
+      : keywords(string_view(keywords)), keywordSearch(splitKeywords(this->keywords)) {}
+
+   /// Search all keywords in a single pass over the word and produce one
+   /// tuple for every keyword that occurs in it, case-insensitively
+   void consume(LocalState& localState, const InputTuple& input) {
+      auto& state = matchStates.get(localState, [&] { return MatchState{vector<uint64_t>(keywordSearch.getNumPatterns()), 0}; });
+      auto tupleNumber = ++state.numTuples;
+      keywordSearch.forEachMatch(input.word, [&](uint32_t keywordId) {
+         if (state.lastMatches[keywordId] == tupleNumber)
+            return;
+         state.lastMatches[keywordId] = tupleNumber;
+         produceOutputTuple({input.word, keywordId});
+      });
+   }
+};
+//---------------------------------------------------------------------------
+#ifdef UDO_STANDALONE
+#include <udo/UDOExport.hpp>
+UDO_STANDALONE_EXPORT(MatchKeywords)
+#endif
+//---------------------------------------------------------------------------
@@ -1,6 +1,10 @@
-#include <charconv>
+#include <array>
+#include <cstdint>
+#include <span>
 #include <string_view>
 //---------------------------------------------------------------------------
+#include <udo/Columns.hpp>
+#include <udo/IntegerList.hpp>
 #include <udo/UDOperator.hpp>
 //---------------------------------------------------------------------------
 using namespace std;
@@ -17,26 +21,29 @@ struct OutputTuple {
 //---------------------------------------------------------------------------
 class SplitArrays : public udo::UDOperator<InputTuple, OutputTuple> {
 public:
-   void consume(LocalState& /*localState*/, const InputTuple& input) {
-      OutputTuple output;
-      output.name = input.name;
-
-      string_view values = input.values;
-
-      const char* currentValueBegin = values.data();
-      const char* it = values.data();
-      const char* end = values.data() + values.size();
-      for (; it != end; ++it) {
-         if (*it == ',' || it + 1 == end) {
-            auto currentValueEnd = *it == ',' ? it : end;
-            if (currentValueBegin != currentValueEnd) {
-               auto result = from_chars(currentValueBegin, currentValueEnd, output.value);
-               if (result.ptr == currentValueEnd)
-                  produceOutputTuple(output);
-            }
+   /// The attributes of the input and output tuples for the standalone driver
+   using InputColumns = udo::Columns<&InputTuple::name, &InputTuple::values>;
+   using OutputColumns = udo::Columns<&OutputTuple::name, &OutputTuple::value>;
 
-            currentValueBegin = it + 1;
+   /// Split the values at the commas and produce one tuple for every value
+   /// that is an integer. The tuples of a row are produced in batches.
+   void consume(LocalState& /*localState*/, const InputTuple& input) {
+      array<OutputTuple, 64> outputs;
+      size_t numOutputs = 0;
+      udo::IntegerListParser::parse(input.values, [&](int64_t value, bool isValid) {
+         outputs[numOutputs] = {input.name, value};
+         numOutputs += isValid;
+         if (numOutputs == outputs.size()) {
+            produceOutputTuples(outputs);
+            numOutputs = 0;
          }
-      }
+      });
+      produceOutputTuples(span<const OutputTuple>(outputs.data(), numOutputs));
    }
 };
+//---------------------------------------------------------------------------
+#ifdef UDO_STANDALONE
+#include <udo/UDOExport.hpp>
+UDO_STANDALONE_EXPORT(SplitArrays)
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,245 @@
+// Checks the vectorized searches and parsers of the runtime against simple
+// reference implementations on random inputs. Every input is placed right before a
+// page that cannot be accessed, so reading past its end crashes the check.
+// Built with -fsanitize=address, inputs on the heap are checked as well.
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include <udo/IntegerList.hpp>
+#include <udo/MultiStringSearch.hpp>
+#include <udo/Random.hpp>
+#include <udo/StringSearch.hpp>
+#include <sys/mman.h>
+//---------------------------------------------------------------------------
+using namespace std;
+using namespace std::literals::string_view_literals;
+//---------------------------------------------------------------------------
+/// Places inputs at the end of a page that is followed by an inaccessible
+/// page
+class GuardedBuffer {
+   public:
+   /// The largest input
+   static constexpr size_t maxSize = 4096;
+
+   private:
+   /// The two pages
+   char* pages;
+
+   public:
+   /// Constructor
+   GuardedBuffer() {
+      void* memory = ::mmap(nullptr, 2 * maxSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (memory == MAP_FAILED || ::mprotect(static_cast<char*>(memory) + maxSize, maxSize, PROT_NONE) != 0) {
+         cerr << "Failed to map the guard page" << endl;
+         abort();
+      }
+      pages = static_cast<char*>(memory);
+   }
+   /// Destructor
+   ~GuardedBuffer() {
+      ::munmap(pages, 2 * maxSize);
+   }
+
+   GuardedBuffer(const GuardedBuffer&) = delete;
+   GuardedBuffer& operator=(const GuardedBuffer&) = delete;
+
+   /// Copy an input so that it ends right before the inaccessible page
+   string_view place(string_view input) {
+      auto* begin = pages + maxSize - input.size();
+      memcpy(begin, input.data(), input.size());
+      return {begin, input.size()};
+   }
+};
+//---------------------------------------------------------------------------
+/// An input in a heap allocation of exactly its size, for AddressSanitizer
+class HeapCopy {
+   private:
+   /// The allocation
+   unique_ptr<char[]> data;
+   /// The size
+   size_t size;
+
+   public:
+   /// Constructor
+   explicit HeapCopy(string_view input) : data(new char[input.size()]), size(input.size()) {
+      memcpy(data.get(), input.data(), size);
+   }
+
+   /// Get the input
+   string_view get() const { return {data.get(), size}; }
+};
+//---------------------------------------------------------------------------
+static string generateString(udo::RandomGenerator& gen, string_view alphabet, size_t size)
+/// Generate a random string of the given alphabet
+{
+   string result(size, '\0');
+   for (auto& c : result)
+      c = alphabet[gen.nextBounded(alphabet.size())];
+   return result;
+}
+//---------------------------------------------------------------------------
+template <typename Patterns>
+static string generateText(udo::RandomGenerator& gen, string_view alphabet, size_t maxSize, const Patterns& patterns)
+/// Generate a random text of the given alphabet, in which a random pattern
+/// is inserted half of the time
+{
+   auto text = generateString(gen, alphabet, gen.nextBounded(maxSize));
+   if (gen.nextBounded(2)) {
+      auto pattern = patterns[gen.nextBounded(patterns.size())];
+      text.insert(gen.nextBounded(text.size() + 1), pattern);
+      text.resize(min(text.size(), maxSize));
+   }
+   return text;
+}
+//---------------------------------------------------------------------------
+static void reportFailure(string_view check, string_view input, string_view detail)
+/// Report a failed check
+{
+   cerr << check << " failed for \"" << input << "\": " << detail << endl;
+}
+//---------------------------------------------------------------------------
+static size_t findCaseInsensitive(string_view text, string_view pattern)
+/// Find a pattern byte by byte, ASCII letters match in either case
+{
+   auto fold = [](char c) { return udo::FoldedPattern::isLetter(c) ? c | 0x20 : c; };
+   for (size_t i = 0; i + pattern.size() <= text.size(); ++i) {
+      size_t j = 0;
+      while (j < pattern.size() && fold(text[i + j]) == fold(pattern[j]))
+         ++j;
+      if (j == pattern.size())
+         return i;
+   }
+   return string_view::npos;
+}
+//---------------------------------------------------------------------------
+static uint64_t checkStringSearch(udo::RandomGenerator& gen, GuardedBuffer& buffer)
+/// Compare all search kernels with the byte-by-byte search. The texts use a
+/// small alphabet, so that the patterns occur often and at the very end.
+{
+   static constexpr array patterns = {"d"sv, "db"sv, "a@b"sv, "data"sv, "database"sv, "DataBase1"sv, "databases and data"sv, "database1database2database3database4database5database6"sv};
+   static constexpr string_view alphabet = "dataDATAbBsSeE1@`"sv;
+
+   uint64_t numFailures = 0;
+   for (unsigned round = 0; round < 20000; ++round) {
+      auto text = generateText(gen, alphabet, 160, patterns);
+      auto guarded = buffer.place(text);
+      HeapCopy heapCopy(text);
+      for (auto pattern : patterns) {
+         auto expected = findCaseInsensitive(text, pattern);
+         for (auto kernel : {udo::SearchKernel::Scalar, udo::SearchKernel::SSE2, udo::SearchKernel::AVX2, udo::SearchKernel::AVX512}) {
+            if (!udo::isSearchKernelSupported(kernel))
+               continue;
+            udo::CaseInsensitiveSearch search(pattern, kernel);
+            if (search.find(guarded) != expected || search.find(heapCopy.get()) != expected) {
+               reportFailure("CaseInsensitiveSearch", text, string(pattern) + " with " + udo::getSearchKernelName(kernel));
+               ++numFailures;
+            }
+         }
+      }
+   }
+   return numFailures;
+}
+//---------------------------------------------------------------------------
+static uint64_t checkMultiStringSearch(udo::RandomGenerator& gen, GuardedBuffer& buffer)
+/// Compare both multi-pattern kernels with the byte-by-byte search of every
+/// pattern. The patterns overlap, so that several occur at once.
+{
+   static constexpr array patterns = {"data"sv, "database"sv, "base"sv, "graph"sv, "GRAPHS2"sv, "privacy"sv, "stream"sv, "cloud"sv, "tar"sv, "aaa"sv};
+   static constexpr string_view alphabet = "datbsegrphDATBSEGRPH2 "sv;
+
+   uint64_t numFailures = 0;
+   for (auto kernel : {udo::MultiSearchKernel::AhoCorasick, udo::MultiSearchKernel::Teddy}) {
+      if (kernel == udo::MultiSearchKernel::Teddy && !udo::CaseInsensitiveMultiSearch::isTeddySupported(patterns))
+         continue;
+      udo::CaseInsensitiveMultiSearch search(patterns, kernel);
+      for (unsigned round = 0; round < 20000; ++round) {
+         auto text = generateText(gen, alphabet, 160, patterns);
+         uint64_t expected = 0;
+         for (size_t i = 0; i < patterns.size(); ++i)
+            if (findCaseInsensitive(text, patterns[i]) != string_view::npos)
+               expected |= 1ull << i;
+
+         HeapCopy heapCopy(text);
+         for (auto input : {buffer.place(text), heapCopy.get()}) {
+            uint64_t matches = 0;
+            search.forEachMatch(input, [&](uint32_t patternId) { matches |= 1ull << patternId; });
+            if (matches != expected || search.containsAny(input) != (expected != 0)) {
+               reportFailure("CaseInsensitiveMultiSearch", text, udo::getMultiSearchKernelName(kernel));
+               ++numFailures;
+            }
+         }
+      }
+   }
+   return numFailures;
+}
+//---------------------------------------------------------------------------
+static uint64_t checkIntegerList(udo::RandomGenerator& gen, GuardedBuffer& buffer)
+/// Compare the integer list parser with std::from_chars() on every field.
+/// The lists contain invalid fields, numbers at the limits of int64_t and
+/// numbers with many leading zeros.
+{
+   static constexpr array numbers = {"9223372036854775807"sv, "-9223372036854775808"sv, "9223372036854775808"sv, "-9223372036854775809"sv, "000000000000000000000042"sv, "12345678901234567890123"sv, "N/A"sv, "false"sv, "1e5"sv};
+   static constexpr string_view alphabet = "0123456789012345678901234567890123456789,,,,,,,,--"sv;
+
+   uint64_t numFailures = 0;
+   vector<pair<int64_t, bool>> fields;
+   for (unsigned round = 0; round < 300000; ++round) {
+      auto list = generateText(gen, alphabet, 200, numbers);
+      // Without a bad byte, most lists would be valid
+      if (!list.empty() && gen.nextBounded(8) == 0)
+         list[gen.nextBounded(list.size())] = "a +x/"[gen.nextBounded(5)];
+
+      // The fields are separated by commas, the empty field after a trailing
+      // comma is skipped
+      vector<pair<int64_t, bool>> expected;
+      for (size_t begin = 0; begin < list.size();) {
+         auto end = min(list.find(',', begin), list.size());
+         int64_t value = 0;
+         auto result = from_chars(list.data() + begin, list.data() + end, value);
+         expected.emplace_back(value, result.ec == errc() && result.ptr == list.data() + end);
+         begin = end + 1;
+      }
+
+      HeapCopy heapCopy(list);
+      for (auto input : {buffer.place(list), heapCopy.get()}) {
+         fields.clear();
+         udo::IntegerListParser::parse(input, [&](int64_t value, bool isValid) { fields.emplace_back(value, isValid); });
+         bool matches = fields.size() == expected.size();
+         for (size_t i = 0; matches && i < fields.size(); ++i)
+            matches = fields[i].second == expected[i].second && (!fields[i].second || fields[i].first == expected[i].first);
+         if (!matches) {
+            reportFailure("IntegerListParser", list, "fields differ from std::from_chars");
+            ++numFailures;
+         }
+      }
+   }
+   return numFailures;
+}
+//---------------------------------------------------------------------------
+int main() {
+   udo::RandomGenerator gen(42);
+   GuardedBuffer buffer;
+
+   uint64_t numFailures = 0;
+   numFailures += checkStringSearch(gen, buffer);
+   numFailures += checkMultiStringSearch(gen, buffer);
+   numFailures += checkIntegerList(gen, buffer);
+
+   if (numFailures > 0) {
+      cerr << numFailures << " checks failed" << endl;
+      return 1;
+   }
+   cout << "All checks passed" << endl;
+   return 0;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,497 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <udo/UDOExport.hpp>
+#include <udo/WorkerPool.hpp>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+// A generic driver for UDOs that were compiled into a shared object, e.g.
+//    docker_compile_standalone.sh -shared -o contains_database.so contains_database.cpp
+// The UDO must be exported with UDO_STANDALONE_EXPORT(). The input is read
+// from a CSV file as written by "COPY ... csv header" or from a binary file
+// that contains the input tuples as they are laid out in memory.
+//---------------------------------------------------------------------------
+static size_t getNumThreads()
+/// Get the number of available threads
+{
+   ::cpu_set_t cpuSet = {};
+   if (::sched_getaffinity(0, sizeof(cpuSet), &cpuSet) != 0)
+      return ~0ull;
+
+   size_t threadCount = CPU_COUNT(&cpuSet);
+   return threadCount;
+}
+//---------------------------------------------------------------------------
+/// A read-only memory mapping of a whole file
+class MappedFile {
+   private:
+   /// The data of the file
+   const char* data = nullptr;
+   /// The size of the file
+   size_t size = 0;
+
+   public:
+   /// Constructor
+   MappedFile() = default;
+   /// Destructor
+   ~MappedFile() {
+      if (data)
+         ::munmap(const_cast<char*>(data), size);
+   }
+
+   MappedFile(const MappedFile&) = delete;
+   MappedFile& operator=(const MappedFile&) = delete;
+
+   /// Map a file. Returns the errno on failure and 0 otherwise.
+   int open(const char* fileName) {
+      int fd = ::open(fileName, O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+         return errno;
+      struct ::stat fileStat{};
+      if (::fstat(fd, &fileStat) < 0) {
+         int error = errno;
+         ::close(fd);
+         return error;
+      }
+      size = fileStat.st_size;
+      if (size > 0) {
+         void* ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+         if (ptr == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            return error;
+         }
+         data = static_cast<const char*>(ptr);
+      }
+      ::close(fd);
+      return 0;
+   }
+
+   /// Get the contents of the file
+   string_view getData() const { return {data, size}; }
+};
+//---------------------------------------------------------------------------
+/// The input tuples of the UDO, stored as they are laid out in memory
+struct InputTuples {
+   /// The memory of the tuples, if they are not taken from the binary file
+   unique_ptr<byte[]> memory;
+   /// The first tuple
+   const byte* data = nullptr;
+   /// The number of tuples
+   uint64_t size = 0;
+   /// The strings that had to be unescaped, they are referenced by the tuples
+   vector<deque<string>> unescapedStrings;
+};
+//---------------------------------------------------------------------------
+/// Parses the lines of a CSV file into tuples of the given layout
+class CsvParser {
+   private:
+   /// The layout of the tuples
+   const udo::ExportedTupleLayout& layout;
+   /// The storage for strings that contained escaped quotes
+   deque<string>& unescapedStrings;
+
+   /// Parse a number with from_chars
+   template <typename T>
+   static bool parseNumber(string_view field, byte* target) {
+      T value;
+      auto result = from_chars(field.data(), field.data() + field.size(), value);
+      if (result.ec != errc() || result.ptr != field.data() + field.size())
+         return false;
+      memcpy(target, &value, sizeof(T));
+      return true;
+   }
+
+   /// Parse a floating point number with strtod, which also works with
+   /// libraries that lack from_chars for floating point numbers
+   template <typename T>
+   static bool parseFloat(string_view field, byte* target) {
+      char buffer[64];
+      if (field.empty() || field.size() >= sizeof(buffer))
+         return false;
+      memcpy(buffer, field.data(), field.size());
+      buffer[field.size()] = '\0';
+      char* end;
+      T value = strtod(buffer, &end);
+      if (end != buffer + field.size())
+         return false;
+      memcpy(target, &value, sizeof(T));
+      return true;
+   }
+
+   /// Parse a field into an attribute
+   bool parseField(string_view field, const udo::ExportedAttribute& attribute, byte* tuple) {
+      auto* target = tuple + attribute.offset;
+      switch (attribute.type) {
+         case udo::AttributeType::Bool: {
+            bool value = field == "t" || field == "true" || field == "1";
+            if (!value && field != "f" && field != "false" && field != "0")
+               return false;
+            memcpy(target, &value, sizeof(bool));
+            return true;
+         }
+         case udo::AttributeType::Int8: return parseNumber<int8_t>(field, target);
+         case udo::AttributeType::Int16: return parseNumber<int16_t>(field, target);
+         case udo::AttributeType::Int32: return parseNumber<int32_t>(field, target);
+         case udo::AttributeType::Int64: return parseNumber<int64_t>(field, target);
+         case udo::AttributeType::UInt8: return parseNumber<uint8_t>(field, target);
+         case udo::AttributeType::UInt16: return parseNumber<uint16_t>(field, target);
+         case udo::AttributeType::UInt32: return parseNumber<uint32_t>(field, target);
+         case udo::AttributeType::UInt64: return parseNumber<uint64_t>(field, target);
+         case udo::AttributeType::Float: return parseFloat<float>(field, target);
+         case udo::AttributeType::Double: return parseFloat<double>(field, target);
+         case udo::AttributeType::String: {
+            udo::String value(field);
+            memcpy(target, &value, sizeof(value));
+            return true;
+         }
+      }
+      __builtin_unreachable();
+   }
+
+   /// Get the next field of a line. Quoted fields are unquoted, and when
+   /// they contain escaped quotes, they are unescaped into new storage.
+   optional<string_view> nextField(string_view& line) {
+      if (line.empty() || line.front() != '"') {
+         auto end = min(line.find(','), line.size());
+         auto field = line.substr(0, end);
+         line.remove_prefix(min(end + 1, line.size()));
+         return field;
+      }
+
+      bool escaped = false;
+      size_t pos = 1;
+      while (true) {
+         pos = line.find('"', pos);
+         if (pos == string_view::npos)
+            return nullopt;
+         if (pos + 1 < line.size() && line[pos + 1] == '"') {
+            escaped = true;
+            pos += 2;
+            continue;
+         }
+         break;
+      }
+      auto field = line.substr(1, pos - 1);
+      line.remove_prefix(pos + 1);
+      if (!line.empty()) {
+         if (line.front() != ',')
+            return nullopt;
+         line.remove_prefix(1);
+      }
+      if (!escaped)
+         return field;
+
+      auto& unescaped = unescapedStrings.emplace_back();
+      unescaped.reserve(field.size());
+      for (size_t i = 0; i < field.size(); ++i) {
+         unescaped += field[i];
+         if (field[i] == '"')
+            ++i;
+      }
+      return unescaped;
+   }
+
+   public:
+   /// Constructor
+   CsvParser(const udo::ExportedTupleLayout& layout, deque<string>& unescapedStrings) : layout(layout), unescapedStrings(unescapedStrings) {}
+
+   /// Parse a line into a tuple. Fields after the last attribute are
+   /// ignored. Returns false if the line is invalid.
+   bool parseLine(string_view line, byte* tuple) {
+      if (!line.empty() && line.back() == '\r')
+         line.remove_suffix(1);
+      for (auto& attribute : layout.getAttributes()) {
+         auto field = nextField(line);
+         if (!field || !parseField(*field, attribute, tuple))
+            return false;
+      }
+      return true;
+   }
+};
+//---------------------------------------------------------------------------
+static bool loadCsv(udo::WorkerPool& pool, string_view data, const udo::ExportedTupleLayout& layout, InputTuples& tuples)
+/// Parse the lines of a CSV file in parallel. Every worker takes a range of
+/// the file, so the lines are counted first to find the tuple index of every
+/// range, and then parsed directly into their place.
+{
+   size_t numWorkers = pool.size();
+   vector<size_t> rangeBegins(numWorkers + 1, data.size());
+   rangeBegins[0] = 0;
+   for (size_t i = 1; i < numWorkers; ++i) {
+      // Every range starts after a newline
+      auto pos = data.find('\n', data.size() * i / numWorkers);
+      rangeBegins[i] = pos == string_view::npos ? data.size() : pos + 1;
+   }
+   for (size_t i = 1; i <= numWorkers; ++i)
+      rangeBegins[i] = max(rangeBegins[i], rangeBegins[i - 1]);
+
+   auto getRange = [&](size_t workerId) { return data.substr(rangeBegins[workerId], rangeBegins[workerId + 1] - rangeBegins[workerId]); };
+
+   vector<uint64_t> firstTuples(numWorkers + 1);
+   pool.run(numWorkers, [&](size_t workerId) {
+      auto range = getRange(workerId);
+      uint64_t numLines = count(range.begin(), range.end(), '\n');
+      if (!range.empty() && range.back() != '\n')
+         ++numLines;
+      firstTuples[workerId + 1] = numLines;
+   });
+   for (size_t i = 1; i <= numWorkers; ++i)
+      firstTuples[i] += firstTuples[i - 1];
+
+   tuples.size = firstTuples[numWorkers];
+   tuples.memory.reset(new byte[tuples.size * layout.size]());
+   tuples.data = tuples.memory.get();
+   tuples.unescapedStrings.resize(numWorkers);
+
+   vector<uint64_t> invalidLines(numWorkers, ~0ull);
+   pool.run(numWorkers, [&](size_t workerId) {
+      CsvParser parser(layout, tuples.unescapedStrings[workerId]);
+      auto range = getRange(workerId);
+      auto* tuple = tuples.memory.get() + firstTuples[workerId] * layout.size;
+      for (uint64_t index = firstTuples[workerId]; !range.empty(); ++index, tuple += layout.size) {
+         auto end = min(range.find('\n'), range.size());
+         if (!parser.parseLine(range.substr(0, end), tuple)) {
+            invalidLines[workerId] = index;
+            return;
+         }
+         range.remove_prefix(min(end + 1, range.size()));
+      }
+   });
+
+   auto invalidLine = *min_element(invalidLines.begin(), invalidLines.end());
+   if (invalidLine != ~0ull) {
+      cerr << "Invalid CSV line " << invalidLine + 1 << " of the data" << endl;
+      return false;
+   }
+   return true;
+}
+//---------------------------------------------------------------------------
+static void printLayout(const char* what, const udo::ExportedTupleLayout& layout)
+/// Print the layout of a tuple type
+{
+   cerr << what << ": " << layout.size << " bytes, alignment " << layout.alignment << ", attributes";
+   for (auto& attribute : layout.getAttributes())
+      cerr << ' ' << udo::getAttributeTypeName(attribute.type) << '@' << attribute.offset;
+   cerr << '\n';
+}
+//---------------------------------------------------------------------------
+static void printTuple(const udo::ExportedTupleLayout& layout, const byte* tuple)
+/// Print a tuple as a CSV line
+{
+   auto print = [&]<typename T>(const udo::ExportedAttribute& attribute, T) {
+      T value;
+      memcpy(&value, tuple + attribute.offset, sizeof(T));
+      if constexpr (sizeof(T) == 1 && !is_same_v<T, bool>)
+         cout << static_cast<int>(value);
+      else
+         cout << value;
+   };
+   bool first = true;
+   for (auto& attribute : layout.getAttributes()) {
+      if (!first)
+         cout << ',';
+      first = false;
+      switch (attribute.type) {
+         case udo::AttributeType::Bool: print(attribute, bool()); break;
+         case udo::AttributeType::Int8: print(attribute, int8_t()); break;
+         case udo::AttributeType::Int16: print(attribute, int16_t()); break;
+         case udo::AttributeType::Int32: print(attribute, int32_t()); break;
+         case udo::AttributeType::Int64: print(attribute, int64_t()); break;
+         case udo::AttributeType::UInt8: print(attribute, uint8_t()); break;
+         case udo::AttributeType::UInt16: print(attribute, uint16_t()); break;
+         case udo::AttributeType::UInt32: print(attribute, uint32_t()); break;
+         case udo::AttributeType::UInt64: print(attribute, uint64_t()); break;
+         case udo::AttributeType::Float: print(attribute, float()); break;
+         case udo::AttributeType::Double: print(attribute, double()); break;
+         case udo::AttributeType::String: {
+            udo::String value;
+            memcpy(&value, tuple + attribute.offset, sizeof(value));
+            cout << string_view(value);
+            break;
+         }
+      }
+   }
+   cout << '\n';
+}
+//---------------------------------------------------------------------------
+template <typename T>
+static bool parseArg(string_view arg, T& value)
+/// Parse a numeric command line argument
+{
+   auto result = from_chars(arg.data(), arg.data() + arg.size(), value);
+   return result.ec == errc() && result.ptr == arg.data() + arg.size();
+}
+//---------------------------------------------------------------------------
+int main(int argc, const char** argv) {
+   bool argError = false;
+   bool benchmark = false;
+   bool binary = false;
+   bool header = true;
+   bool printOutput = false;
+   size_t numThreads = getNumThreads();
+   size_t morselSize = udo::MorselScheduler::adaptiveMorselSize;
+   optional<udo::Placement> placement;
+   string_view libraryName;
+   string_view inputFileName;
+
+   const char** argIt = argv;
+   ++argIt;
+   const char** argEnd = argv + argc;
+   for (; argIt != argEnd; ++argIt) {
+      string_view arg(*argIt);
+      if (arg.empty())
+         continue;
+      if (arg == "--benchmark") {
+         benchmark = true;
+      } else if (arg == "--binary") {
+         binary = true;
+      } else if (arg == "--no-header") {
+         header = false;
+      } else if (arg == "--output") {
+         printOutput = true;
+      } else if (arg == "--threads") {
+         if (++argIt == argEnd || !parseArg(*argIt, numThreads) || numThreads == 0) {
+            argError = true;
+            break;
+         }
+      } else if (arg == "--morsel-size") {
+         if (++argIt == argEnd || !parseArg(*argIt, morselSize)) {
+            argError = true;
+            break;
+         }
+      } else if (arg == "--placement") {
+         if (++argIt == argEnd || !(placement = udo::parsePlacement(*argIt))) {
+            argError = true;
+            break;
+         }
+      } else if (libraryName.empty()) {
+         libraryName = arg;
+      } else if (inputFileName.empty()) {
+         inputFileName = arg;
+      } else {
+         argError = true;
+         break;
+      }
+   }
+
+   if (!argError && (inputFileName.empty() || (benchmark && printOutput)))
+      argError = true;
+
+   if (argError) {
+      cerr << "Usage: " << argv[0] << " [--benchmark | --output] [--binary | --no-header] [--threads n] [--morsel-size n (0 = adaptive)] [--placement compact|scatter|cores] <shared object> <input file>" << endl;
+      return 2;
+   }
+
+   // Load the UDO
+   string libraryPath(libraryName);
+   if (libraryPath.find('/') == string::npos)
+      libraryPath = "./" + libraryPath;
+   void* library = ::dlopen(libraryPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+   if (!library) {
+      cerr << "Failed loading " << libraryName << ": " << ::dlerror() << endl;
+      return 1;
+   }
+   auto exportFunction = reinterpret_cast<const udo::ExportedUDO* (*) ()>(::dlsym(library, udo::exportFunctionName));
+   if (!exportFunction) {
+      cerr << libraryName << " does not export a UDO, use UDO_STANDALONE_EXPORT()" << endl;
+      return 1;
+   }
+   auto& exported = *exportFunction();
+   if (exported.version != udo::exportVersion) {
+      cerr << libraryName << " was compiled for version " << exported.version << " of the interface, expected " << udo::exportVersion << endl;
+      return 1;
+   }
+   cerr << "UDO: " << exported.name << '\n';
+   printLayout("input", exported.input);
+   printLayout("output", exported.output);
+   if (exported.input.alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+      cerr << "Input tuples with an alignment of " << exported.input.alignment << " are not supported" << endl;
+      return 1;
+   }
+
+   // Load the input
+   MappedFile inputFile;
+   if (int error = inputFile.open(string(inputFileName).c_str())) {
+      cerr << "Failed opening " << inputFileName << ": " << strerror(error) << endl;
+      return 1;
+   }
+   InputTuples inputs;
+   auto loadStart = chrono::steady_clock::now();
+   if (binary) {
+      auto attributes = exported.input.getAttributes();
+      if (any_of(attributes.begin(), attributes.end(), [](auto& attribute) { return attribute.type == udo::AttributeType::String; })) {
+         cerr << "Binary input cannot contain strings" << endl;
+         return 1;
+      }
+      auto data = inputFile.getData();
+      if (data.size() % exported.input.size != 0) {
+         cerr << "The size of " << inputFileName << " is not a multiple of the tuple size" << endl;
+         return 1;
+      }
+      inputs.data = reinterpret_cast<const byte*>(data.data());
+      inputs.size = data.size() / exported.input.size;
+   } else {
+      auto data = inputFile.getData();
+      // Discard the header line
+      if (header)
+         data.remove_prefix(min(data.find('\n') + 1, data.size()));
+      udo::WorkerPool loadPool(numThreads, placement.value_or(udo::Placement::Compact));
+      if (!loadCsv(loadPool, data, exported.input, inputs))
+         return 1;
+   }
+   auto loadDuration = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - loadStart).count();
+   cerr << "loaded " << inputs.size << " tuples in " << loadDuration / 1e6 << " ms\n";
+
+   // Run the UDO
+   void* pool = exported.createPool(numThreads, placement.value_or(udo::Placement::Compact));
+   struct OutputContext {
+      const udo::ExportedTupleLayout& layout;
+      bool print;
+   } outputContext{exported.output, printOutput};
+   auto consumeOutput = [](void* context, const void* tuples, uint64_t numTuples) {
+      auto& outputContext = *static_cast<OutputContext*>(context);
+      if (!outputContext.print)
+         return;
+      for (uint64_t i = 0; i < numTuples; ++i)
+         printTuple(outputContext.layout, static_cast<const byte*>(tuples) + i * outputContext.layout.size);
+   };
+
+   for (unsigned i = 0; i < (benchmark ? 11 : 1); ++i) {
+      auto start = chrono::steady_clock::now();
+      auto numOutput = exported.run(pool, morselSize, inputs.data, inputs.size, consumeOutput, &outputContext);
+      auto duration = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+      if (!benchmark) {
+         cerr << "produced " << numOutput << " tuples in " << duration / 1e6 << " ms, " << inputs.size / (duration / 1e9) / 1e6 << " M input tuples/s\n";
+         if (!printOutput)
+            cout << numOutput << '\n';
+      } else if (i > 0) {
+         // Don't measure the first run
+         cout << duration << '\n';
+      }
+   }
+
+   exported.destroyPool(pool);
+   return 0;
+}
+//---------------------------------------------------------------------------
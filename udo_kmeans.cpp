@@ -6,10 +6,8 @@
 #include <functional>
 #include <iterator>
 #include <limits>
-#include <memory>
 #include <new>
 #include <optional>
-#include <random>
 #include <span>
 #include <type_traits>
 #include <utility>
@@ -17,6 +15,7 @@
 #ifdef UDO_STANDALONE
 #include <charconv>
 #include <chrono>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -25,7 +24,10 @@
 #include <sched.h>
 #endif
 //---------------------------------------------------------------------------
+#include <udo/Arena.hpp>
+#include <udo/Random.hpp>
 #include <udo/UDOperator.hpp>
+#include <udo/WorkerStates.hpp>
 //---------------------------------------------------------------------------
 using namespace std;
 //---------------------------------------------------------------------------
@@ -52,7 +54,8 @@ struct Output {
 };
 //---------------------------------------------------------------------------
 /// A container that has stable references, constant time insertion at the end
-/// and allocates memory in exponentially increasing sizes.
+/// and allocates memory in exponentially increasing sizes. The chunks are
+/// allocated with malloc() or from an arena.
 template <typename T>
 class ChunkedStorage {
    private:
@@ -66,9 +69,13 @@ class ChunkedStorage {
       ChunkHeader* next = nullptr;
       /// The number of elements that are stored in this chunk
       size_t numElements = 0;
+      /// Was the chunk allocated with malloc()? Chunks from arenas are only
+      /// freed with the arena, also after they were merged into another
+      /// ChunkedStorage.
+      bool isMalloced;
 
-      /// Constructor from a size
-      explicit ChunkHeader(size_t size) : size(size) {}
+      /// Constructor
+      ChunkHeader(size_t size, bool isMalloced) : size(size), isMalloced(isMalloced) {}
 
       /// Get the pointer to the first element
       T* getElements() {
@@ -225,6 +232,14 @@ class ChunkedStorage {
             else
                return Iterator(chunk, 0);
          }
+
+         /// Get all elements of the range
+         std::span<std::conditional_t<isConst, const T, T>> getElements() const {
+            if (chunk)
+               return {chunk->getElements(), chunk->numElements};
+            else
+               return {};
+         }
       };
 
       private:
@@ -276,6 +291,8 @@ class ChunkedStorage {
       return (1024 - sizeof(ChunkHeader) - 1) / sizeof(T) + 1;
    }
 
+   /// The arena for new chunks, if any
+   udo::Arena* arena = nullptr;
    /// The first chunk
    ChunkHeader* frontChunk = nullptr;
    /// The last chunk
@@ -289,7 +306,8 @@ class ChunkedStorage {
       while (chunk) {
          auto* next = chunk->next;
          std::destroy_n(chunk->getElements(), chunk->numElements);
-         std::free(chunk);
+         if (chunk->isMalloced)
+            std::free(chunk);
          chunk = next;
       }
       frontChunk = nullptr;
@@ -301,8 +319,8 @@ class ChunkedStorage {
    void addChunk() {
       size_t newChunkElements = std::max(numElements / 8, minimumNumElements());
       size_t newChunkSize = sizeof(ChunkHeader) + newChunkElements * sizeof(T);
-      auto* chunkPtr = static_cast<ChunkHeader*>(std::malloc(newChunkSize));
-      new (chunkPtr) ChunkHeader(newChunkSize);
+      void* memory = arena ? arena->allocate(newChunkSize, alignof(ChunkHeader)) : std::malloc(newChunkSize);
+      auto* chunkPtr = new (memory) ChunkHeader(newChunkSize, !arena);
 
       if (backChunk)
          backChunk->next = chunkPtr;
@@ -314,6 +332,9 @@ class ChunkedStorage {
    public:
    /// Constructor
    ChunkedStorage() = default;
+   /// Constructor for a storage that allocates its chunks from an arena,
+   /// which must outlive the chunks
+   explicit ChunkedStorage(udo::Arena* arena) : arena(arena) {}
 
    /// Destructor
    ~ChunkedStorage() {
@@ -321,7 +342,7 @@ class ChunkedStorage {
    }
 
    /// Move constructor
-   ChunkedStorage(ChunkedStorage&& other) noexcept : frontChunk(other.frontChunk), backChunk(other.backChunk), numElements(other.numElements) {
+   ChunkedStorage(ChunkedStorage&& other) noexcept : arena(other.arena), frontChunk(other.frontChunk), backChunk(other.backChunk), numElements(other.numElements) {
       other.frontChunk = nullptr;
       other.backChunk = nullptr;
       other.numElements = 0;
@@ -334,6 +355,7 @@ class ChunkedStorage {
 
       freeChunks();
 
+      arena = other.arena;
       frontChunk = other.frontChunk;
       backChunk = other.backChunk;
       numElements = other.numElements;
@@ -365,7 +387,10 @@ class ChunkedStorage {
       if (!other.frontChunk)
          return;
       if (!backChunk) {
+         // Keep the own arena for new chunks
+         auto* ownArena = arena;
          *this = std::move(other);
+         arena = ownArena;
          return;
       }
       backChunk->next = other.frontChunk;
@@ -424,11 +449,7 @@ class ReservoirSample {
    /// The number of tuples seen for sampling
    uint64_t elementsSeen;
    /// The random engine
-   mt19937_64 mt;
-   /// The distribution for random numbers
-   uniform_real_distribution<double> doubleDist;
-   /// The distribution for random slots
-   uniform_int_distribution<uint64_t> slotDist;
+   udo::RandomGenerator gen;
    /// The number of elements to skip
    uint64_t skip;
    /// The W of Li's algorithm L
@@ -437,10 +458,10 @@ class ReservoirSample {
    public:
    /// Constructor
    ReservoirSample(uint64_t sampleSize, uint64_t seed)
-      : sample(sampleSize), limit(sampleSize), elementsSeen(0), mt(seed), doubleDist(0.0, 1.0), slotDist(0, sampleSize - 1) {
+      : sample(sampleSize), limit(sampleSize), elementsSeen(0), gen(seed) {
       // Calculate initial skip after algorithm l https://doi.org/10.1145/198429.198435
-      w = exp(log(doubleDist(mt)) / limit);
-      skip = static_cast<uint64_t>(floor(log(doubleDist(mt)) / log(1.0 - w)));
+      w = exp(log(gen.nextDouble()) / limit);
+      skip = static_cast<uint64_t>(floor(log(gen.nextDouble()) / log(1.0 - w)));
    }
 
    /// Set the number of tuples that were seen for this sample
@@ -457,9 +478,9 @@ class ReservoirSample {
    uint64_t getRandomSlot() {
       // Calculate next step after algorithm l https://doi.org/10.1145/198429.198435
       if (skip == 0) {
-         w *= exp(log(doubleDist(mt)) / limit);
-         skip = static_cast<uint64_t>(floor(log(doubleDist(mt)) / log(1.0 - w)));
-         return slotDist(mt);
+         w *= exp(log(gen.nextDouble()) / limit);
+         skip = static_cast<uint64_t>(floor(log(gen.nextDouble()) / log(1.0 - w)));
+         return gen.nextBounded(limit);
       }
       skip--;
       return limit + skip;
@@ -501,8 +522,7 @@ class ReservoirSample {
          // is definitely full.
          // Use algorithm R to merge the remaining tuples
          for (uint64_t i = 0; i < mergeSource->elementsSeen; ++i) {
-            auto dist = uniform_int_distribution<uint64_t>(0, mergeTarget->elementsSeen + i);
-            auto sampleIndex = dist(mt);
+            auto sampleIndex = gen.nextBounded(mergeTarget->elementsSeen + i + 1);
             if (sampleIndex < limit)
                mergeTarget->sample[sampleIndex] = move(mergeSource->sample[i]);
          }
@@ -512,9 +532,8 @@ class ReservoirSample {
             move(mergeTarget->sample.begin(), mergeTarget->sample.end(), mergeSource->sample.begin());
       } else {
          // Do a regular merge of two full samples.
-         auto dist = uniform_int_distribution<uint64_t>(1, elementsSeen + target.elementsSeen);
          for (auto i = 0u; i < limit; i++)
-            if (dist(mt) <= elementsSeen)
+            if (gen.nextBounded(elementsSeen + target.elementsSeen) < elementsSeen)
                target.sample[i] = move(sample[i]);
       }
 
@@ -545,11 +564,9 @@ class KMeans : public udo::UDOperator<Input, Output> {
       ChunkedStorage<Output> tuples;
       /// The sample for this worker
       ReservoirSample<Output*> sample;
-      /// The next local state
-      ConsumeLocalState* next = nullptr;
 
       /// Constructor
-      ConsumeLocalState(size_t sampleSize, uint64_t seed) : sample(sampleSize, seed) {}
+      ConsumeLocalState(size_t sampleSize, uint64_t seed, udo::Arena& arena) : tuples(&arena), sample(sampleSize, seed) {}
    };
 
    /// A cluster center
@@ -570,29 +587,33 @@ class KMeans : public udo::UDOperator<Input, Output> {
       uint64_t numPoints;
    };
 
-   /// One element of the linked list that contains all local cluster centers
-   /// in recalculateMeans
-   struct LocalClustersEntry {
+   /// The local cluster centers of a worker in recalculateMeans
+   struct LocalClusters {
       /// The cluster centers
       vector<LocalClusterCenter> centers;
-      /// The next entry
-      LocalClustersEntry* next = nullptr;
    };
 
    /// How many tuples should be passed to produceOutputTuple in every call of postProduce()
    static constexpr uint64_t morselSize = 10000;
    /// The number of clusters
    unsigned numClusters = 8;
+   /// The arenas of the workers for the tuples. They are kept until the UDO
+   /// is destroyed because the tuples are merged into a single storage.
+   udo::WorkerStates<udo::Arena> arenas;
    /// The storage for all tuples
    ChunkedStorage<Output> tuples;
    /// The local states in consume
-   atomic<ConsumeLocalState*> consumeLocalStateList = nullptr;
+   udo::WorkerStates<ConsumeLocalState> consumeLocalStates;
    /// The cluster centers
    vector<ClusterCenter> centers;
-   /// The linked list of local cluster centers used in recalculateMeans
-   atomic<LocalClustersEntry*> localClusterCentersList = nullptr;
+   /// The local cluster centers used in recalculateMeans. The standalone
+   /// runtime keeps them for all iterations, the database gets new ones in
+   /// every iteration.
+   udo::WorkerStates<LocalClusters> localClusterCenters;
    /// The mutex flag for the prepare steps of the operations
    atomic_flag prepareMutex = false;
+   /// The mutex flag for merging the local cluster centers
+   atomic_flag mergeMutex = false;
    /// The number of iterations
    unsigned numIterations = 0;
    /// The number of points that changed their cluster
@@ -606,33 +627,14 @@ class KMeans : public udo::UDOperator<Input, Output> {
       centers.resize(numClusters);
    }
 
-   /// Destructor
-   ~KMeans() {
-      // Make sure that the local states are cleaned up in case the query was
-      // aborted early.
-      for (auto* localState = consumeLocalStateList.load(); localState;) {
-         unique_ptr<ConsumeLocalState> localStatePtr(localState);
-         localState = localStatePtr->next;
-      }
-      for (auto* localState = localClusterCentersList.load(); localState;) {
-         unique_ptr<LocalClustersEntry> localStatePtr(localState);
-         localState = localStatePtr->next;
-      }
-   }
-
    /// Consume an input tuple
    void consume(LocalState& rawLocalState, const Input& input) {
-      auto*& localState = reinterpret_cast<ConsumeLocalState*&>(rawLocalState.data);
-      if (!localState) {
-         auto newLocalState = make_unique<ConsumeLocalState>(numClusters, udo::getRandom());
-         newLocalState->next = consumeLocalStateList.load();
-         while (!consumeLocalStateList.compare_exchange_weak(newLocalState->next, newLocalState.get()))
-            ;
-
-         localState = newLocalState.get();
-         // This will be deallocated in PrepareInitializeClusters
-         newLocalState.release();
-      }
+      // The local states will be deallocated in PrepareInitializeClusters
+      auto* localState = &consumeLocalStates.get(rawLocalState, [&] {
+         LocalState arenaState{};
+         auto& arena = arenas.get(arenaState, [] { return udo::Arena(udo::HugePages::Transparent); });
+         return ConsumeLocalState(numClusters, udo::getRandom(), arena);
+      });
 
       Output tuple;
       tuple.x = input.x;
@@ -653,15 +655,12 @@ class KMeans : public udo::UDOperator<Input, Output> {
       if (!prepareMutex.test_and_set()) {
          // Merge the tuples and samples of all workers
          ReservoirSample<Output*> mergedSample(numClusters, 0);
-         for (auto* consumeLocalState = consumeLocalStateList.exchange(nullptr); consumeLocalState;) {
-            unique_ptr<ConsumeLocalState> localStatePtr(consumeLocalState);
-
-            localStatePtr->sample.setElementsSeen(localStatePtr->tuples.size());
-            tuples.merge(move(localStatePtr->tuples));
-            localStatePtr->sample.mergeInto(mergedSample);
-
-            consumeLocalState = consumeLocalState->next;
-         }
+         consumeLocalStates.forEach([&](ConsumeLocalState& localState) {
+            localState.sample.setElementsSeen(localState.tuples.size());
+            tuples.merge(move(localState.tuples));
+            localState.sample.mergeInto(mergedSample);
+         });
+         consumeLocalStates.clear();
 
          if (tuples.size() < numClusters) {
             udo::printDebug("less points than clusters, aborting\n");
@@ -689,6 +688,7 @@ class KMeans : public udo::UDOperator<Input, Output> {
 
    /// Prepare the associate points operation
    Operation prepareAssociatePoints() {
+      mergeMutex.clear();
       if (!prepareMutex.test_and_set()) {
          numChangedPoints.store(0);
          tuplesIter = tuples.parallelIter();
@@ -744,18 +744,7 @@ class KMeans : public udo::UDOperator<Input, Output> {
 
    /// Calculate the means of the clusters
    Operation recalculateMeans(LocalState& localState) {
-      auto*& localClusters = reinterpret_cast<LocalClustersEntry*&>(localState.data);
-      if (!localClusters) {
-         auto newLocalClusters = make_unique<LocalClustersEntry>();
-         newLocalClusters->centers.resize(numClusters);
-         newLocalClusters->next = localClusterCentersList.load();
-         while (!localClusterCentersList.compare_exchange_weak(newLocalClusters->next, newLocalClusters.get()))
-            ;
-
-         localClusters = newLocalClusters.get();
-         // This will be deallocated in FinishRecalculateMeans
-         newLocalClusters.release();
-      }
+      auto* localClusters = &localClusterCenters.get(localState, [&] { return LocalClusters{vector<LocalClusterCenter>(numClusters)}; });
 
       auto tuples = tuplesIter.next();
       if (!tuples)
@@ -773,25 +762,29 @@ class KMeans : public udo::UDOperator<Input, Output> {
 
    /// Switch to associate points after recalculating means
    Operation finishRecalculateMeans() {
-      auto* localEntry = localClusterCentersList.exchange(nullptr);
-      if (!localEntry)
-         return PrepareAssociatePoints;
-
       prepareMutex.clear();
+      if (mergeMutex.test_and_set())
+         return PrepareAssociatePoints;
 
-      // Loop over the local cluster centers and sum them up
+      // Loop over the local cluster centers, sum them up, and reset them for
+      // the next iteration
       vector<LocalClusterCenter> mergedClusters(numClusters);
-      while (localEntry) {
-         unique_ptr<LocalClustersEntry> entryPtr(localEntry);
+      localClusterCenters.forEach([&](LocalClusters& localClusters) {
          for (unsigned i = 0; i < numClusters; ++i) {
             auto& mergedCenter = mergedClusters[i];
-            auto& localCenter = entryPtr->centers[i];
+            auto& localCenter = localClusters.centers[i];
             mergedCenter.x += localCenter.x;
             mergedCenter.y += localCenter.y;
             mergedCenter.numPoints += localCenter.numPoints;
+            localCenter = {};
          }
-         localEntry = entryPtr->next;
-      }
+      });
+
+#ifndef UDO_STANDALONE
+      // The database does not keep the LocalState across calls, so every
+      // call of recalculateMeans added a state that must not pile up
+      localClusterCenters.clear();
+#endif
 
       // Write out the new cluster centers
       for (unsigned i = 0; i < numClusters; ++i) {
@@ -813,6 +806,37 @@ class KMeans : public udo::UDOperator<Input, Output> {
    }
 
    public:
+   /// Whether a step only does work in one thread. The prepare and finish
+   /// steps are still guarded by prepareMutex for runtimes that call them on
+   /// all workers.
+   static constexpr bool isSerialStep(uint32_t step) {
+      switch (static_cast<Operation>(step)) {
+         case AssociatePoints:
+         case RecalculateMeans:
+         case WriteOutput:
+            return false;
+         default:
+            return true;
+      }
+   }
+
+   /// Get the name of a step for traces
+   static const char* getStepName(uint32_t step) {
+      switch (static_cast<Operation>(step)) {
+         case PrepareInitializeClusters: return "PrepareInitializeClusters";
+         case FinishInitializeClusters: return "FinishInitializeClusters";
+         case PrepareAssociatePoints: return "PrepareAssociatePoints";
+         case AssociatePoints: return "AssociatePoints";
+         case FinishAssociatePoints: return "FinishAssociatePoints";
+         case PrepareRecalculateMeans: return "PrepareRecalculateMeans";
+         case RecalculateMeans: return "RecalculateMeans";
+         case FinishRecalculateMeans: return "FinishRecalculateMeans";
+         case PrepareWriteOutput: return "PrepareWriteOutput";
+         case WriteOutput: return "WriteOutput";
+      }
+      return nullptr;
+   }
+
    /// Do extra work
    uint32_t extraWork(LocalState& localState, uint32_t step) {
       switch (static_cast<Operation>(step)) {
@@ -844,8 +868,7 @@ class KMeans : public udo::UDOperator<Input, Output> {
    bool postProduce(LocalState& /*localState*/) {
       auto tuples = tuplesIter.next();
       if (tuples) {
-         for (auto& tuple : *tuples)
-            produceOutputTuple(tuple);
+         produceOutputTuples(tuples->getElements());
          return false;
       } else {
          return true;
@@ -866,10 +889,93 @@ static size_t getNumThreads()
    return threadCount;
 }
 //---------------------------------------------------------------------------
+// Programs that include this file for the UDO define UDO_NO_MAIN
+#ifndef UDO_NO_MAIN
+//---------------------------------------------------------------------------
+static vector<Input> readInputs(const string& inputFileName)
+/// Read all input tuples from the input file
+{
+   ifstream inputFile(inputFileName);
+
+   // Discard the header line
+   {
+      string header;
+      getline(inputFile, header);
+   }
+
+   vector<Input> inputs;
+
+   while (inputFile) {
+      Input i;
+      string field;
+      char* end;
+
+      getline(inputFile, field, ',');
+      if (!inputFile)
+         break;
+      end = field.data() + field.size();
+      i.x = strtod(field.data(), &end);
+      getline(inputFile, field, ',');
+      if (!inputFile)
+         break;
+      end = field.data() + field.size();
+      i.y = strtod(field.data(), &end);
+      getline(inputFile, field);
+      if (!inputFile)
+         break;
+      from_chars(field.data(), field.data() + field.size(), i.payload);
+
+      inputs.push_back(i);
+   }
+
+   return inputs;
+}
+//---------------------------------------------------------------------------
+static void parseInputs(const udo::FileBlockStream::Block& block, vector<Input>& inputs)
+/// Parse the input tuples from a block of whole lines of the input file
+{
+   const char* current = block.data.data();
+   const char* end = current + block.data.size();
+
+   // Discard the header line
+   if (block.index == 0) {
+      while (current != end && *current != '\n')
+         ++current;
+      if (current != end)
+         ++current;
+   }
+
+   while (current != end) {
+      Input i;
+      char* fieldEnd;
+
+      // The block is followed by a null byte, so strtod() cannot read past it
+      i.x = strtod(current, &fieldEnd);
+      if (*fieldEnd != ',')
+         break;
+      i.y = strtod(fieldEnd + 1, &fieldEnd);
+      if (*fieldEnd != ',')
+         break;
+      auto result = from_chars(fieldEnd + 1, end, i.payload);
+      current = result.ptr;
+      while (current != end && *current != '\n')
+         ++current;
+      if (current != end)
+         ++current;
+
+      inputs.push_back(i);
+   }
+}
+//---------------------------------------------------------------------------
 int main(int argc, const char** argv) {
    bool argError = false;
    bool fullOutput = false;
    bool benchmark = false;
+   bool perfCounters = false;
+   bool memoryUsage = false;
+   bool streaming = false;
+   optional<udo::Placement> placement;
+   string_view traceFileName;
    string_view inputFileName;
 
    const char** argIt = argv;
@@ -883,6 +989,23 @@ int main(int argc, const char** argv) {
          fullOutput = true;
       } else if (arg == "--benchmark") {
          benchmark = true;
+      } else if (arg == "--perf") {
+         perfCounters = true;
+      } else if (arg == "--memory") {
+         memoryUsage = true;
+      } else if (arg == "--streaming") {
+         streaming = true;
+      } else if (arg == "--placement") {
+         if (++argIt == argEnd || !(placement = udo::parsePlacement(*argIt))) {
+            argError = true;
+            break;
+         }
+      } else if (arg == "--trace") {
+         if (++argIt == argEnd || !udo::traceEnabled) {
+            argError = true;
+            break;
+         }
+         traceFileName = *argIt;
       } else {
          if (inputFileName.empty()) {
             inputFileName = arg;
@@ -897,52 +1020,51 @@ int main(int argc, const char** argv) {
       argError = true;
 
    if (argError) {
-      cerr << "Usage: " << argv[0] << " [--full-output] [--benchmark] <input file>" << std::endl;
+      cerr << "Usage: " << argv[0] << " [--full-output] [--benchmark] [--perf] [--memory] [--streaming] [--placement compact|scatter|cores] [--trace <trace file>] <input file>" << std::endl;
+      if (!udo::traceEnabled)
+         cerr << "--trace requires compiling with -DUDO_TRACE" << std::endl;
       return 2;
    }
 
-   ifstream inputFile(inputFileName);
-
-   // Discard the header line
-   {
-      string header;
-      getline(inputFile, header);
-   }
+   // The threads are reused by all runs
+   udo::WorkerPool pool(getNumThreads(), placement.value_or(udo::Placement::Compact));
+   if (placement)
+      udo::printPlacement(cerr, pool.getPlacement(), pool.getWorkerCpus());
 
-   vector<Input> inputs;
-
-   while (inputFile) {
-      Input i;
-      string field;
-      char* end;
-
-      getline(inputFile, field, ',');
-      if (!inputFile)
-         break;
-      end = field.data() + field.size();
-      i.x = strtod(field.data(), &end);
-      getline(inputFile, field, ',');
-      if (!inputFile)
-         break;
-      end = field.data() + field.size();
-      i.y = strtod(field.data(), &end);
-      getline(inputFile, field);
-      if (!inputFile)
-         break;
-      from_chars(field.data(), field.data() + field.size(), i.payload);
+   // In streaming mode, every run reads and parses the file itself
+   string inputFileNameStr(inputFileName);
+   auto runKMeans = [&](udo::UDOStandalone<KMeans>& standalone, KMeans& kMeans, span<const Input> inputs) {
+      if (!streaming) {
+         standalone.run(kMeans, inputs);
+         return true;
+      }
+      udo::FileBlockStream stream;
+      if (int error = stream.open(inputFileNameStr.c_str(), 2 * pool.size() + 2)) {
+         cerr << "Failed opening " << inputFileName << ": " << strerror(error) << endl;
+         return false;
+      }
+      standalone.run(kMeans, stream, parseInputs);
+      return true;
+   };
 
-      inputs.push_back(i);
+   // Every worker copies the part of the input that it will consume into a
+   // buffer, so that the part is local to the worker
+   udo::HugePageBuffer<Input> inputs;
+   if (!streaming) {
+      auto parsedInputs = readInputs(inputFileNameStr);
+      inputs = udo::allocateInputBuffer<Input>(pool, parsedInputs.size(), [&](span<Input> part, size_t offset) {
+         copy_n(parsedInputs.begin() + offset, part.size(), part.begin());
+      });
    }
 
-   vector<Output> outputs(inputs.size());
-
    if (benchmark) {
       for (unsigned i = 0; i < 11; ++i) {
-         udo::UDOStandalone<KMeans> standalone(getNumThreads(), 10000);
+         udo::UDOStandalone<KMeans> standalone(pool);
          KMeans kMeans;
 
          auto start = chrono::steady_clock::now();
-         standalone.run(kMeans, inputs, outputs);
+         if (!runKMeans(standalone, kMeans, inputs))
+            return 1;
          auto end = chrono::steady_clock::now();
          auto duration_ms = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
          // Don't measure the first run
@@ -950,17 +1072,32 @@ int main(int argc, const char** argv) {
             cout << duration_ms << '\n';
       }
    } else {
-      udo::UDOStandalone<KMeans> standalone(getNumThreads(), 10000);
+      udo::UDOStandalone<KMeans> standalone(pool);
       KMeans kMeans;
-      standalone.run(kMeans, inputs, outputs);
+      if (perfCounters && !standalone.setPerfCounters(true))
+         perfCounters = false;
+      if (!runKMeans(standalone, kMeans, inputs))
+         return 1;
+
+      if (perfCounters)
+         standalone.printPerfCounters(cerr);
+      if (memoryUsage)
+         standalone.printArenaUsage(cerr);
+      if (!traceFileName.empty()) {
+         ofstream traceFile{string(traceFileName)};
+         standalone.getTrace().writeChromeTrace(traceFile);
+         standalone.getTrace().printSummary(cerr);
+      }
 
       if (fullOutput) {
-         for (auto& output : standalone.getOutput())
-            cout << output.x << ',' << output.y << ',' << output.payload << ',' << output.clusterId << '\n';
+         for (auto chunk : standalone.getOutputChunks())
+            for (auto& output : chunk)
+               cout << output.x << ',' << output.y << ',' << output.payload << ',' << output.clusterId << '\n';
       } else {
          vector<size_t> clusterCounts(8);
-         for (auto& output : standalone.getOutput())
-            ++clusterCounts[output.clusterId];
+         for (auto chunk : standalone.getOutputChunks())
+            for (auto& output : chunk)
+               ++clusterCounts[output.clusterId];
 
          for (size_t i = 0; i < clusterCounts.size(); ++i)
             cout << i << ": " << clusterCounts[i] << '\n';
@@ -971,4 +1108,5 @@ int main(int argc, const char** argv) {
 }
 //---------------------------------------------------------------------------
 #endif
+#endif
 //---------------------------------------------------------------------------
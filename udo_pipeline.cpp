@@ -0,0 +1,182 @@
+// The UDOs below are written as separate translation units that all use the
+// same global names, so every UDO is included into its own namespace as
+// described in udo/UDOPipeline.hpp.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <new>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <udo/Columns.hpp>
+#include <udo/UDOPipeline.hpp>
+#include <udo/UDOStandalone.hpp>
+#include <udo/UDOperator.hpp>
+#include <udo/WorkerStates.hpp>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+//---------------------------------------------------------------------------
+#define UDO_NO_MAIN
+namespace points {
+#include "create_points.cpp"
+}
+namespace kmeans {
+#include "udo_kmeans.cpp"
+}
+namespace regression_points {
+#include "create_regression_points.cpp"
+}
+namespace regression {
+#include "udo_regression.cpp"
+}
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+/// Converts the generated points into the input of k-means, the payload is
+/// the cluster the point was generated for
+struct PointToKMeansInput {
+   kmeans::Input operator()(const points::Output& point) const {
+      return {point.x, point.y, point.clusterId};
+   }
+};
+//---------------------------------------------------------------------------
+/// Converts the generated points into the input of the regression
+struct PointToRegressionInput {
+   regression::Input operator()(const regression_points::Output& point) const {
+      return {point.x, point.y};
+   }
+};
+//---------------------------------------------------------------------------
+template <typename Producer, typename Consumer, typename Convert, typename MakeProducer>
+static vector<typename Consumer::OutputTuple> runPipeline(udo::WorkerPool& pool, const MakeProducer& makeProducer, bool materialize, bool benchmark)
+/// Generate the input with the producer and pass it to the consumer. Without
+/// materialize, both UDOs run as one pipeline. Otherwise, the output of the
+/// producer is stored and then used as the input of the consumer.
+{
+   vector<typename Consumer::OutputTuple> outputs;
+   for (unsigned i = 0; i < (benchmark ? 11 : 1); ++i) {
+      Producer producer = makeProducer();
+      Consumer consumer;
+      outputs.clear();
+
+      auto start = chrono::steady_clock::now();
+      if (!materialize) {
+         udo::UDOPipeline<Producer, Consumer, Convert> pipeline(producer, consumer);
+         udo::UDOStandalone<udo::UDOPipeline<Producer, Consumer, Convert>> standalone(pool);
+         standalone.run(pipeline, span<const udo::EmptyTuple>());
+         for (auto chunk : standalone.getOutputChunks())
+            outputs.insert(outputs.end(), chunk.begin(), chunk.end());
+      } else {
+         udo::UDOStandalone<Producer> producerStandalone(pool);
+         producerStandalone.run(producer, span<const udo::EmptyTuple>());
+         vector<typename Consumer::InputTuple> inputs;
+         inputs.reserve(producerStandalone.getOutputSize());
+         for (auto chunk : producerStandalone.getOutputChunks())
+            ranges::transform(chunk, back_inserter(inputs), Convert());
+
+         udo::UDOStandalone<Consumer> consumerStandalone(pool);
+         consumerStandalone.run(consumer, inputs);
+         for (auto chunk : consumerStandalone.getOutputChunks())
+            outputs.insert(outputs.end(), chunk.begin(), chunk.end());
+      }
+      auto end = chrono::steady_clock::now();
+
+      // Don't measure the first run
+      if (benchmark && i > 0)
+         cout << chrono::duration_cast<chrono::nanoseconds>(end - start).count() << '\n';
+   }
+   return outputs;
+}
+//---------------------------------------------------------------------------
+int main(int argc, const char** argv) {
+   bool argError = false;
+   bool benchmark = false;
+   bool materialize = false;
+   optional<udo::Placement> placement;
+   string_view pipelineName;
+   uint64_t numPoints = 0;
+
+   const char** argIt = argv;
+   ++argIt;
+   const char** argEnd = argv + argc;
+   for (; argIt != argEnd; ++argIt) {
+      string_view arg(*argIt);
+      if (arg.empty())
+         continue;
+      if (arg == "--benchmark") {
+         benchmark = true;
+      } else if (arg == "--materialize") {
+         materialize = true;
+      } else if (arg == "--placement") {
+         if (++argIt == argEnd || !(placement = udo::parsePlacement(*argIt))) {
+            argError = true;
+            break;
+         }
+      } else if (pipelineName.empty()) {
+         pipelineName = arg;
+      } else if (numPoints == 0) {
+         auto result = from_chars(arg.data(), arg.data() + arg.size(), numPoints);
+         if (result.ec != errc() || result.ptr != arg.data() + arg.size() || numPoints == 0) {
+            argError = true;
+            break;
+         }
+      } else {
+         argError = true;
+         break;
+      }
+   }
+
+   if (!argError && (numPoints == 0 || (pipelineName != "kmeans" && pipelineName != "regression")))
+      argError = true;
+
+   if (argError) {
+      cerr << "Usage: " << argv[0] << " [--benchmark] [--materialize] [--placement compact|scatter|cores] kmeans|regression <number of points>" << endl;
+      return 2;
+   }
+
+   // The threads are reused by all runs
+   udo::WorkerPool pool(kmeans::getNumThreads(), placement.value_or(udo::Placement::Compact));
+   if (placement)
+      udo::printPlacement(cerr, pool.getPlacement(), pool.getWorkerCpus());
+
+   if (pipelineName == "kmeans") {
+      auto makeProducer = [&] { return points::CreatePoints(numPoints); };
+      auto outputs = runPipeline<points::CreatePoints, kmeans::KMeans, PointToKMeansInput>(pool, makeProducer, materialize, benchmark);
+      if (!benchmark) {
+         vector<size_t> clusterCounts(8);
+         for (auto& output : outputs)
+            ++clusterCounts[output.clusterId];
+         for (size_t i = 0; i < clusterCounts.size(); ++i)
+            cout << i << ": " << clusterCounts[i] << '\n';
+      }
+   } else {
+      auto makeProducer = [&] { return regression_points::CreateRegressionPoints(1, 2, 3, numPoints); };
+      auto outputs = runPipeline<regression_points::CreateRegressionPoints, regression::LinearRegression, PointToRegressionInput>(pool, makeProducer, materialize, benchmark);
+      if (!benchmark && !outputs.empty())
+         regression::printParams(outputs[0]);
+   }
+
+   return 0;
+}
+//---------------------------------------------------------------------------
@@ -1,16 +1,18 @@
 #include <array>
 #include <atomic>
-#include <memory>
+#include <span>
 #include <string_view>
+#include <utility>
 #ifdef UDO_STANDALONE
+#include <algorithm>
 #include <atomic>
 #include <cerrno>
 #include <charconv>
 #include <chrono>
 #include <iostream>
 #include <map>
+#include <optional>
 #include <string>
-#include <thread>
 #include <udo/UDOStandalone.hpp>
 #include <fcntl.h>
 #include <sched.h>
@@ -19,7 +21,9 @@
 #include <unistd.h>
 #endif
 //---------------------------------------------------------------------------
+#include <udo/Columns.hpp>
 #include <udo/UDOperator.hpp>
+#include <udo/WorkerStates.hpp>
 //---------------------------------------------------------------------------
 using namespace std;
 using namespace std::literals::string_view_literals;
@@ -120,34 +124,63 @@ class LinearRegression : public udo::UDOperator<Input, Output> {
       double sumx2y = 0.0;
    };
 
-   /// The local state of a thread in the regression
-   struct RegressionLocalState {
-      /// The partial sums
-      PartialSums partialSums;
-      /// The pointer to the next local state
-      RegressionLocalState* next = nullptr;
-   };
-
-   /// The list of local states
-   atomic<RegressionLocalState*> localStateList = nullptr;
+   /// The partial sums of all threads
+   udo::WorkerStates<PartialSums> threadSums;
    /// The mutex flag to return the result
    atomic_flag resultMutex = false;
 
+   /// Add a batch of values to the partial sums. The sums are split into
+   /// independent lanes so that the compiler can compute them with SIMD
+   /// instructions.
+   template <typename GetValues>
+   void addSums(LocalState& rawLocalState, size_t numTuples, const GetValues& getValues) {
+      static constexpr size_t numLanes = 4;
+      double sum1[numLanes] = {}, sumx[numLanes] = {}, sumx2[numLanes] = {}, sumx3[numLanes] = {};
+      double sumx4[numLanes] = {}, sumy[numLanes] = {}, sumxy[numLanes] = {}, sumx2y[numLanes] = {};
+
+      auto addValues = [&](size_t lane, double x, double y) {
+         double x2 = x * x;
+         sum1[lane] += 1;
+         sumx[lane] += x;
+         sumx2[lane] += x2;
+         sumx3[lane] += x2 * x;
+         sumx4[lane] += x2 * x2;
+         sumy[lane] += y;
+         sumxy[lane] += x * y;
+         sumx2y[lane] += x2 * y;
+      };
+
+      size_t numVectorized = numTuples - numTuples % numLanes;
+      for (size_t i = 0; i < numVectorized; i += numLanes) {
+         for (size_t lane = 0; lane < numLanes; ++lane) {
+            auto [x, y] = getValues(i + lane);
+            addValues(lane, x, y);
+         }
+      }
+      for (size_t i = numVectorized; i < numTuples; ++i) {
+         auto [x, y] = getValues(i);
+         addValues(0, x, y);
+      }
+
+      auto& sums = threadSums.get(rawLocalState);
+      for (size_t lane = 0; lane < numLanes; ++lane) {
+         sums.sum1 += sum1[lane];
+         sums.sumx += sumx[lane];
+         sums.sumx2 += sumx2[lane];
+         sums.sumx3 += sumx3[lane];
+         sums.sumx4 += sumx4[lane];
+         sums.sumy += sumy[lane];
+         sums.sumxy += sumxy[lane];
+         sums.sumx2y += sumx2y[lane];
+      }
+   }
+
    public:
+   /// The input attributes as columns
+   using InputColumns = udo::Columns<&Input::x, &Input::y>;
+
    /// Consume an input tuple
    void consume(LocalState& rawLocalState, const Input& input) {
-      auto*& localState = reinterpret_cast<RegressionLocalState*&>(rawLocalState.data);
-      if (!localState) {
-         auto newLocalState = make_unique<RegressionLocalState>();
-         newLocalState->next = localStateList.load();
-         while (!localStateList.compare_exchange_weak(newLocalState->next, newLocalState.get()))
-            ;
-
-         localState = newLocalState.get();
-         // This will be deallocated in postProduce()
-         newLocalState.release();
-      }
-
       double x = input.x;
       double y = input.y;
 
@@ -157,7 +190,7 @@ class LinearRegression : public udo::UDOperator<Input, Output> {
       auto xy = x * y;
       auto x2y = x2 * y;
 
-      auto& sums = localState->partialSums;
+      auto& sums = threadSums.get(rawLocalState);
       sums.sum1 += 1;
       sums.sumx += x;
       sums.sumx2 += x2;
@@ -168,6 +201,18 @@ class LinearRegression : public udo::UDOperator<Input, Output> {
       sums.sumx2y += x2y;
    }
 
+   /// Consume a batch of input tuples
+   void consumeBatch(LocalState& rawLocalState, span<const Input> inputs) {
+      addSums(rawLocalState, inputs.size(), [&](size_t i) { return pair(inputs[i].x, inputs[i].y); });
+   }
+
+   /// Consume a morsel of columnar input
+   void consumeColumns(LocalState& rawLocalState, const udo::ColumnMorsel<InputColumns>& morsel) {
+      auto xs = morsel.column<0>();
+      auto ys = morsel.column<1>();
+      addSums(rawLocalState, morsel.size(), [&](size_t i) { return pair(xs[i], ys[i]); });
+   }
+
    /// Produce the output
    bool postProduce(LocalState& /*localState*/) {
       if (resultMutex.test_and_set())
@@ -175,10 +220,7 @@ class LinearRegression : public udo::UDOperator<Input, Output> {
 
       // Sum up all partial sums from the local states
       PartialSums sums;
-      for (auto* localState = localStateList.load(); localState;) {
-         unique_ptr<RegressionLocalState> localStatePtr(localState);
-
-         auto& lsums = localStatePtr->partialSums;
+      threadSums.forEach([&](PartialSums& lsums) {
          sums.sum1 += lsums.sum1;
          sums.sumx += lsums.sumx;
          sums.sumx2 += lsums.sumx2;
@@ -187,9 +229,7 @@ class LinearRegression : public udo::UDOperator<Input, Output> {
          sums.sumy += lsums.sumy;
          sums.sumxy += lsums.sumxy;
          sums.sumx2y += lsums.sumx2y;
-
-         localState = localStatePtr->next;
-      }
+      });
 
       // clang-format off
       double detInv = 1 / (
@@ -224,6 +264,18 @@ class LinearRegression : public udo::UDOperator<Input, Output> {
 //---------------------------------------------------------------------------
 #ifdef UDO_STANDALONE
 //---------------------------------------------------------------------------
+static void printParams(const Output& params)
+/// Print the fitted parameters
+{
+   cout << "a = " << params.a << '\n';
+   cout << "b = " << params.b << '\n';
+   cout << "c = " << params.c << '\n';
+   cout << "-> y = " << params.a << " + " << params.b << "x" << " + " << params.c << "x^2\n";
+}
+//---------------------------------------------------------------------------
+// Programs that include this file for the UDO define UDO_NO_MAIN
+#ifndef UDO_NO_MAIN
+//---------------------------------------------------------------------------
 static size_t getNumThreads()
 /// Get the number of available threads
 {
@@ -235,9 +287,73 @@ static size_t getNumThreads()
    return threadCount;
 }
 //---------------------------------------------------------------------------
+static void parseInputs(string_view inputStr, vector<Input>& inputs)
+/// Parse the input tuples from whole lines of the input file
+{
+   char strBuffer[64];
+   while (!inputStr.empty()) {
+      Input in;
+
+      size_t commaPos = inputStr.find(',');
+      memcpy(strBuffer, inputStr.data(), commaPos - 1);
+      strBuffer[commaPos] = '\0';
+      inputStr.remove_prefix(commaPos + 1);
+      in.x = strtod(strBuffer, nullptr);
+
+      size_t nlPos = inputStr.find('\n');
+      memcpy(strBuffer, inputStr.data(), nlPos - 1);
+      strBuffer[nlPos] = '\0';
+      inputStr.remove_prefix(nlPos + 1);
+      in.y = strtod(strBuffer, nullptr);
+
+      inputs.push_back(in);
+   }
+}
+//---------------------------------------------------------------------------
+static int runStreaming(udo::WorkerPool& pool, const char* inputFileName, bool benchmark)
+/// Run the regression while the input file is read and parsed
+{
+   auto parseBlock = [](const udo::FileBlockStream::Block& block, vector<Input>& inputs) {
+      string_view data = block.data;
+      // Discard the header line
+      if (block.index == 0)
+         data.remove_prefix(min(data.find('\n') + 1, data.size()));
+      parseInputs(data, inputs);
+   };
+
+   vector<Output> outputs(3);
+   for (unsigned i = 0; i < (benchmark ? 11 : 1); ++i) {
+      udo::UDOStandalone<LinearRegression> standalone(pool);
+      LinearRegression regression;
+
+      auto start = chrono::steady_clock::now();
+      udo::FileBlockStream stream;
+      if (int error = stream.open(inputFileName, 2 * pool.size() + 2)) {
+         cerr << "Failed opening " << inputFileName << ": " << strerror(error) << endl;
+         return 1;
+      }
+      standalone.run(regression, stream, parseBlock, outputs);
+      auto end = chrono::steady_clock::now();
+
+      if (!benchmark) {
+         if (!stream.usesIoUring())
+            cerr << "io_uring is not available, reading with pread" << endl;
+         printParams(standalone.getOutput()[0]);
+      } else if (i > 0) {
+         // Don't measure the first run
+         cout << chrono::duration_cast<chrono::nanoseconds>(end - start).count() << '\n';
+      }
+   }
+
+   return 0;
+}
+//---------------------------------------------------------------------------
 int main(int argc, const char** argv) {
    bool argError = false;
    bool benchmark = false;
+   bool columnar = false;
+   bool streaming = false;
+   optional<udo::Placement> placement;
    string_view inputFileName;
 
    const char** argIt = argv;
@@ -249,6 +365,15 @@ int main(int argc, const char** argv) {
          continue;
       if (arg == "--benchmark") {
          benchmark = true;
+      } else if (arg == "--columnar") {
+         columnar = true;
+      } else if (arg == "--streaming") {
+         streaming = true;
+      } else if (arg == "--placement") {
+         if (++argIt == argEnd || !(placement = udo::parsePlacement(*argIt))) {
+            argError = true;
+            break;
+         }
       } else {
          if (inputFileName.empty()) {
             inputFileName = arg;
@@ -259,14 +384,23 @@ int main(int argc, const char** argv) {
       }
    }
 
-   if (!argError && inputFileName.empty())
+   if (!argError && (inputFileName.empty() || (columnar && streaming)))
       argError = true;
 
    if (argError) {
-      cerr << "Usage: " << argv[0] << " [--benchmark] <input file>" << endl;
+      cerr << "Usage: " << argv[0] << " [--benchmark] [--columnar | --streaming] [--placement compact|scatter|cores] <input file>" << endl;
       return 2;
    }
 
+   // The threads are used for parsing and reused by all runs
+   udo::WorkerPool pool(getNumThreads(), placement.value_or(udo::Placement::Compact));
+   size_t numThreads = pool.size();
+   if (placement)
+      udo::printPlacement(cerr, pool.getPlacement(), pool.getWorkerCpus());
+
+   if (streaming)
+      return runStreaming(pool, inputFileName.data(), benchmark);
+
    int inputFileFd = ::open(inputFileName.data(), O_RDONLY | O_CLOEXEC);
    if (inputFileFd < 0) {
       cerr << "Failed opening " << inputFileName << ": " << strerror(errno) << endl;
@@ -293,79 +427,75 @@ int main(int argc, const char** argv) {
 
    static constexpr size_t sizePerThread = 4096 * 4;
 
-   size_t numThreads = getNumThreads();
-
    vector<vector<Input>> threadInputs(numThreads);
-   vector<thread> threads;
    atomic<size_t> currentOffset = 0;
 
-   for (size_t threadId = 0; threadId < numThreads; ++threadId) {
-      threads.emplace_back([&, threadId, inputFileData] {
-         auto& inputs = threadInputs[threadId];
+   pool.run(numThreads, [&, inputFileData](size_t threadId) {
+      auto& inputs = threadInputs[threadId];
 
-         while (true) {
-            size_t localOffset = currentOffset.load();
-            if (localOffset >= inputFileData.size())
-               break;
+      while (true) {
+         size_t localOffset = currentOffset.load();
+         if (localOffset >= inputFileData.size())
+            break;
 
-            size_t offsetEnd = localOffset + sizePerThread;
+         size_t offsetEnd = localOffset + sizePerThread;
 
-            if (offsetEnd >= inputFileData.size()) {
+         if (offsetEnd >= inputFileData.size()) {
+            offsetEnd = inputFileData.size();
+         } else {
+            // Go forward until the next newline
+            size_t newlineOffset = inputFileData.find('\n', offsetEnd);
+            if (newlineOffset == string_view::npos)
                offsetEnd = inputFileData.size();
-            } else {
-               // Go forward until the next newline
-               size_t newlineOffset = inputFileData.find('\n', offsetEnd);
-               if (newlineOffset == string_view::npos)
-                  offsetEnd = inputFileData.size();
-               else
-                  offsetEnd = newlineOffset + 1;
-            }
-
-            if (!currentOffset.compare_exchange_weak(localOffset, offsetEnd))
-               continue;
-
-            string_view inputStr = inputFileData.substr(localOffset, offsetEnd - localOffset);
-
-            char strBuffer[64];
-            while (!inputStr.empty()) {
-               Input in;
-
-               size_t commaPos = inputStr.find(',');
-               memcpy(strBuffer, inputStr.data(), commaPos - 1);
-               strBuffer[commaPos] = '\0';
-               inputStr.remove_prefix(commaPos + 1);
-               in.x = strtod(strBuffer, nullptr);
-
-               size_t nlPos = inputStr.find('\n');
-               memcpy(strBuffer, inputStr.data(), nlPos - 1);
-               strBuffer[nlPos] = '\0';
-               inputStr.remove_prefix(nlPos + 1);
-               in.y = strtod(strBuffer, nullptr);
-
-               inputs.push_back(in);
-            }
+            else
+               offsetEnd = newlineOffset + 1;
          }
-      });
-   }
 
-   for (auto& thread : threads)
-      thread.join();
+         if (!currentOffset.compare_exchange_weak(localOffset, offsetEnd))
+            continue;
+
+         parseInputs(inputFileData.substr(localOffset, offsetEnd - localOffset), inputs);
+      }
+   });
 
    ::munmap(inputFilePtr, fileStat.st_size);
 
-   vector<Input> inputs;
-   for (auto& threadInput : threadInputs)
-      inputs.insert(inputs.end(), threadInput.begin(), threadInput.end());
+   // Concatenate the parsed tuples into a buffer in which every worker copies
+   // the part that it will consume, so that the part is local to the worker
+   vector<size_t> threadOffsets(numThreads + 1);
+   for (size_t i = 0; i < numThreads; ++i)
+      threadOffsets[i + 1] = threadOffsets[i] + threadInputs[i].size();
+   auto inputs = udo::allocateInputBuffer<Input>(pool, threadOffsets.back(), [&](span<Input> part, size_t offset) {
+      auto thread = upper_bound(threadOffsets.begin(), threadOffsets.end(), offset) - threadOffsets.begin() - 1;
+      for (size_t copied = 0; copied < part.size(); ++thread) {
+         auto begin = offset + copied - threadOffsets[thread];
+         auto count = min(threadInputs[thread].size() - begin, part.size() - copied);
+         copy_n(threadInputs[thread].begin() + begin, count, part.begin() + copied);
+         copied += count;
+      }
+   });
+   threadInputs.clear();
 
    vector<Output> outputs(3);
 
+   // Run the regression on columns instead of tuples if requested
+   udo::ColumnarInput<LinearRegression::InputColumns> columnarInputs;
+   if (columnar)
+      columnarInputs = udo::ColumnarInput<LinearRegression::InputColumns>::fromTuples(inputs);
+   auto runRegression = [&](udo::UDOStandalone<LinearRegression>& standalone, LinearRegression& regression) {
+      if (columnar)
+         standalone.run(regression, columnarInputs, outputs);
+      else
+         standalone.run(regression, inputs, outputs);
+   };
+
    if (benchmark) {
       for (unsigned i = 0; i < 11; ++i) {
-         udo::UDOStandalone<LinearRegression> standalone(numThreads, 10000);
+         udo::UDOStandalone<LinearRegression> standalone(pool);
          LinearRegression regression;
 
          auto start = chrono::steady_clock::now();
-         standalone.run(regression, inputs, outputs);
+         runRegression(standalone, regression);
          auto end = chrono::steady_clock::now();
          auto duration_ms = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
          // Don't measure the first run
@@ -373,18 +503,15 @@ int main(int argc, const char** argv) {
             cout << duration_ms << '\n';
       }
    } else {
-      udo::UDOStandalone<LinearRegression> standalone(numThreads, 10000);
+      udo::UDOStandalone<LinearRegression> standalone(pool);
       LinearRegression regression;
-      standalone.run(regression, inputs, outputs);
+      runRegression(standalone, regression);
 
-      auto& params = standalone.getOutput()[0];
-      cout << "a = " << params.a << '\n';
-      cout << "b = " << params.b << '\n';
-      cout << "c = " << params.c << '\n';
-      cout << "-> y = " << params.a << " + " << params.b << "x" << " + " << params.c << "x^2\n";
+      printParams(standalone.getOutput()[0]);
    }
 
    return 0;
 }
 //---------------------------------------------------------------------------
 #endif
+#endif
@@ -0,0 +1,130 @@
+#include <cstdint>
+#ifdef UDO_STANDALONE
+#include <chrono>
+#include <charconv>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include <udo/UDOStandalone.hpp>
+#include <sched.h>
+#endif
+//---------------------------------------------------------------------------
+#include <udo/UDOperator.hpp>
+//---------------------------------------------------------------------------
+using namespace std;
+//---------------------------------------------------------------------------
+struct Tuple {
+   uint64_t a;
+};
+//---------------------------------------------------------------------------
+/// An operator that does nothing but going through a fixed number of
+/// extraWork() steps. It is used to measure the latency of a step
+/// transition in the runtime.
+class Steps : public udo::UDOperator<Tuple, Tuple> {
+   private:
+   /// The number of steps
+   uint32_t numSteps;
+
+   public:
+   /// Constructor
+   explicit Steps(uint32_t numSteps) : numSteps(numSteps) {}
+
+   /// Go to the next step
+   uint32_t extraWork(LocalState& /*localState*/, uint32_t stepId) {
+      if (stepId + 1 >= numSteps)
+         return extraWorkDone;
+      return stepId + 1;
+   }
+};
+//---------------------------------------------------------------------------
+#ifdef UDO_STANDALONE
+//---------------------------------------------------------------------------
+static size_t getNumThreads()
+/// Get the number of available threads
+{
+   ::cpu_set_t cpuSet = {};
+   if (::sched_getaffinity(0, sizeof(cpuSet), &cpuSet) != 0)
+      return ~0ull;
+
+   size_t threadCount = CPU_COUNT(&cpuSet);
+   return threadCount;
+}
+//---------------------------------------------------------------------------
+int main(int argc, const char** argv) {
+   bool argError = false;
+   uint32_t numSteps = 10000;
+   optional<udo::Placement> placement;
+
+   const char** argIt = argv;
+   ++argIt;
+   const char** argEnd = argv + argc;
+   for (; argIt != argEnd; ++argIt) {
+      string_view arg(*argIt);
+      if (arg == "--steps") {
+         if (++argIt == argEnd) {
+            argError = true;
+            break;
+         }
+         string_view value(*argIt);
+         auto result = from_chars(value.data(), value.data() + value.size(), numSteps);
+         if (result.ptr != value.data() + value.size() || numSteps == 0) {
+            cerr << "Invalid number of steps: " << value << endl;
+            return 2;
+         }
+      } else if (arg == "--placement") {
+         if (++argIt == argEnd || !(placement = udo::parsePlacement(*argIt))) {
+            argError = true;
+            break;
+         }
+      } else {
+         argError = true;
+         break;
+      }
+   }
+
+   if (argError) {
+      cerr << "Usage: " << argv[0] << " [--steps <n>] [--placement compact|scatter|cores]" << endl;
+      return 2;
+   }
+
+   size_t maxThreads = getNumThreads();
+   vector<size_t> threadCounts;
+   for (size_t numThreads = 1; numThreads < maxThreads; numThreads *= 2)
+      threadCounts.push_back(numThreads);
+   threadCounts.push_back(maxThreads);
+
+   // The input is empty, so all runs consist of the state transitions only:
+   // one into extraWork, numSteps - 1 between steps, and one into the output.
+   vector<Tuple> inputs;
+   vector<Tuple> outputs;
+   uint64_t numTransitions = numSteps + 1;
+
+   cout << "threads,ns_per_step\n";
+   for (auto numThreads : threadCounts) {
+      udo::WorkerPool pool(numThreads, placement.value_or(udo::Placement::Compact));
+      if (placement)
+         udo::printPlacement(cerr, pool.getPlacement(), pool.getWorkerCpus());
+
+      uint64_t bestDuration = ~0ull;
+      for (unsigned i = 0; i < 11; ++i) {
+         udo::UDOStandalone<Steps> standalone(pool);
+         Steps steps(numSteps);
+
+         auto start = chrono::steady_clock::now();
+         standalone.run(steps, inputs, outputs);
+         auto end = chrono::steady_clock::now();
+         uint64_t duration = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+         // Don't measure the first run
+         if (i > 0)
+            bestDuration = min(bestDuration, duration);
+      }
+
+      cout << numThreads << ',' << bestDuration / numTransitions << '\n';
+   }
+
+   return 0;
+}
+//---------------------------------------------------------------------------
+#endif
+//---------------------------------------------------------------------------
@@ -0,0 +1,122 @@
+// The words are generated with the CreateWords UDO, which is written as a
+// separate translation unit and therefore included into its own namespace as
+// described in udo/UDOPipeline.hpp.
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <udo/MultiStringSearch.hpp>
+#include <udo/Random.hpp>
+#include <udo/StringSearch.hpp>
+#include <udo/UDOStandalone.hpp>
+#include <udo/UDOperator.hpp>
+//---------------------------------------------------------------------------
+#define UDO_NO_MAIN
+namespace words {
+#include "create_words.cpp"
+}
+//---------------------------------------------------------------------------
+using namespace std;
+using namespace std::literals::string_view_literals;
+//---------------------------------------------------------------------------
+static bool containsDatabaseLoop(string_view word)
+/// The byte-at-a-time search that ContainsDatabase used before the search
+/// kernels, as the baseline
+{
+   static constexpr string_view databaseLower = "database"sv;
+   static constexpr string_view databaseUpper = "DATABASE"sv;
+
+   size_t currentIndex = 0;
+   size_t patternIndex = 0;
+   while (currentIndex < word.size()) {
+      if (word[currentIndex] == databaseLower[patternIndex] || word[currentIndex] == databaseUpper[patternIndex]) {
+         ++currentIndex;
+         ++patternIndex;
+         if (patternIndex == databaseLower.size())
+            return true;
+      } else {
+         if (patternIndex == 0)
+            ++currentIndex;
+         patternIndex = 0;
+      }
+   }
+   return false;
+}
+//---------------------------------------------------------------------------
+template <typename F>
+static void benchmark(string_view name, span<const udo::String> words, uint64_t numBytes, const F& contains)
+/// Search all words on one thread and print the best throughput of 10 runs
+{
+   uint64_t bestDuration = ~0ull;
+   uint64_t numMatches = 0;
+   for (unsigned i = 0; i < 11; ++i) {
+      auto start = chrono::steady_clock::now();
+      numMatches = 0;
+      for (auto& word : words)
+         numMatches += contains(word);
+      auto end = chrono::steady_clock::now();
+      uint64_t duration = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+      // Don't measure the first run
+      if (i > 0)
+         bestDuration = min(bestDuration, duration);
+   }
+   cout << name << ',' << numMatches << ',' << static_cast<double>(numBytes) / bestDuration << '\n';
+}
+//---------------------------------------------------------------------------
+int main(int argc, const char** argv) {
+   uint64_t numWords = 1000000;
+   if (argc > 2 || (argc == 2 && from_chars(argv[1], argv[1] + strlen(argv[1]), numWords).ptr != argv[1] + strlen(argv[1]))) {
+      cerr << "Usage: " << argv[0] << " [<number of words>]" << endl;
+      return 2;
+   }
+
+   // Generate the words like the benchmarks of ContainsDatabase
+   udo::UDOStandalone<words::CreateWords> standalone(1);
+   words::CreateWords createWords(numWords);
+   standalone.run(createWords, span<const udo::EmptyTuple>());
+   vector<udo::String> words;
+   uint64_t numBytes = 0;
+   for (auto chunk : standalone.getOutputChunks()) {
+      for (auto& output : chunk) {
+         words.push_back(output.word);
+         numBytes += output.word.size();
+      }
+   }
+
+   // The throughput is measured per thread in GB/s of string data
+   cout << "search,matches,gb_per_s\n";
+   benchmark("loop", words, numBytes, containsDatabaseLoop);
+   for (auto kernel : {udo::SearchKernel::Scalar, udo::SearchKernel::SSE2, udo::SearchKernel::AVX2, udo::SearchKernel::AVX512}) {
+      if (!udo::isSearchKernelSupported(kernel))
+         continue;
+      udo::CaseInsensitiveSearch search("database"sv, kernel);
+      benchmark(udo::getSearchKernelName(kernel), words, numBytes, [&](string_view word) { return search.contains(word); });
+   }
+
+   // Count the keywords that occur in every word, once per keyword and in
+   // one pass like MatchKeywords
+   static constexpr array keywords = {"database"sv, "mining"sv, "graph"sv, "privacy"sv, "stream"sv, "transaction"sv, "learning"sv, "cloud"sv};
+   vector<udo::CaseInsensitiveSearch> keywordSearches(keywords.begin(), keywords.end());
+   benchmark("keywords-separate", words, numBytes, [&](string_view word) { return count_if(keywordSearches.begin(), keywordSearches.end(), [&](auto& search) { return search.contains(word); }); });
+   for (auto kernel : {udo::MultiSearchKernel::AhoCorasick, udo::MultiSearchKernel::Teddy}) {
+      if (kernel == udo::MultiSearchKernel::Teddy && !udo::CaseInsensitiveMultiSearch::isTeddySupported(keywords))
+         continue;
+      udo::CaseInsensitiveMultiSearch search(keywords, kernel);
+      benchmark(string("keywords-") + udo::getMultiSearchKernelName(kernel), words, numBytes, [&](string_view word) {
+         uint64_t matches = 0;
+         search.forEachMatch(word, [&](uint32_t keywordId) { matches |= 1ull << keywordId; });
+         return __builtin_popcountll(matches);
+      });
+   }
+
+   return 0;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,150 @@
+#ifndef H_udo_runtime_Arena
+#define H_udo_runtime_Arena
+//---------------------------------------------------------------------------
+#include "udo/HugePages.hpp"
+#include "udo/UDOperator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// The memory use of all arenas created by a worker. Every worker has its
+/// own instance on its own cache line, so the counters are not contended.
+struct alignas(64) ArenaUsage {
+   /// The number of bytes mapped by the arenas
+   std::atomic<uint64_t> reservedBytes = 0;
+   /// The part of reservedBytes that is backed by huge pages
+   std::atomic<uint64_t> hugePageBytes = 0;
+   /// The number of bytes handed out by the arenas
+   std::atomic<uint64_t> allocatedBytes = 0;
+};
+//---------------------------------------------------------------------------
+#ifdef UDO_STANDALONE
+/// The usage counters of the worker that runs on the current thread. They
+/// are set by the standalone runtime.
+inline thread_local ArenaUsage* currentArenaUsage = nullptr;
+#endif
+//---------------------------------------------------------------------------
+/// A bump allocator for the working memory of a UDO. An arena is not thread
+/// safe, so every worker uses its own arena, e.g. in udo::WorkerStates, and
+/// its memory is local to the worker that created it. Single allocations
+/// cannot be freed, all memory is released at once with release() or when
+/// the arena is destroyed. Memory is taken directly from the kernel in
+/// blocks that grow exponentially, so workers never contend in malloc().
+class Arena {
+   public:
+   /// The size of the first block without huge pages
+   static constexpr size_t minBlockSize = 64u << 10;
+   /// The maximum size of a block unless a larger allocation requires it
+   static constexpr size_t maxBlockSize = 64u << 20;
+
+   private:
+   /// A block of memory
+   struct Block {
+      /// The memory
+      void* memory;
+      /// The size of the block
+      size_t size;
+   };
+
+   /// All blocks of this arena
+   std::vector<Block> blocks;
+   /// The next free byte of the current block
+   std::byte* next = nullptr;
+   /// The end of the current block
+   std::byte* end = nullptr;
+   /// The size of the next block
+   size_t nextBlockSize;
+   /// Whether huge pages should be used
+   HugePages hugePages;
+   /// The usage counters of the worker that created the arena, if any. They
+   /// live as long as the UDOStandalone, so an arena that is kept across
+   /// runs counts towards the run in which it allocates.
+   ArenaUsage* usage = nullptr;
+
+   /// Add a block that can hold at least the given number of bytes
+   void addBlock(size_t minSize) {
+      size_t pageSize = getMappingGranularity(hugePages);
+      size_t size = std::max(nextBlockSize, (minSize + pageSize - 1) & ~(pageSize - 1));
+      nextBlockSize = std::min(nextBlockSize * 2, maxBlockSize);
+
+      bool isHugePage;
+      auto* memory = mapMemory(size, hugePages, isHugePage);
+      if (!memory) {
+         printDebug("out of memory for an arena\n");
+         std::abort();
+      }
+      blocks.push_back({memory, size});
+      next = static_cast<std::byte*>(memory);
+      end = next + size;
+
+      if (usage) {
+         usage->reservedBytes.fetch_add(size, std::memory_order_relaxed);
+         if (isHugePage)
+            usage->hugePageBytes.fetch_add(size, std::memory_order_relaxed);
+      }
+   }
+
+   public:
+   /// Constructor
+   explicit Arena(HugePages hugePages = HugePages::None) : nextBlockSize(hugePages == HugePages::None ? minBlockSize : hugePageSize), hugePages(hugePages) {
+#ifdef UDO_STANDALONE
+      usage = currentArenaUsage;
+#endif
+   }
+   /// Destructor
+   ~Arena() {
+      release();
+   }
+
+   /// Move constructor
+   Arena(Arena&& other) noexcept
+      : blocks(std::move(other.blocks)), next(std::exchange(other.next, nullptr)), end(std::exchange(other.end, nullptr)), nextBlockSize(other.nextBlockSize), hugePages(other.hugePages), usage(other.usage) {
+      other.blocks.clear();
+   }
+
+   Arena(const Arena&) = delete;
+   Arena& operator=(const Arena&) = delete;
+
+   /// Allocate memory with the given alignment, which must be a power of two
+   /// no larger than the page size
+   void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+      auto* ptr = reinterpret_cast<std::byte*>((reinterpret_cast<uintptr_t>(next) + alignment - 1) & ~(alignment - 1));
+      if (!next || reinterpret_cast<uintptr_t>(ptr) + size > reinterpret_cast<uintptr_t>(end)) [[unlikely]] {
+         addBlock(size);
+         ptr = next;
+      }
+      next = ptr + size;
+      if (usage)
+         usage->allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+      return ptr;
+   }
+
+   /// Release all memory of the arena. All pointers returned by allocate()
+   /// become invalid.
+   void release() {
+      for (auto& block : blocks)
+         ::munmap(block.memory, block.size);
+      blocks.clear();
+      next = end = nullptr;
+      nextBlockSize = hugePages == HugePages::None ? minBlockSize : hugePageSize;
+   }
+
+   /// Get the number of bytes mapped by this arena
+   uint64_t getReservedBytes() const {
+      uint64_t reservedBytes = 0;
+      for (auto& block : blocks)
+         reservedBytes += block.size;
+      return reservedBytes;
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,91 @@
+#ifndef H_udo_runtime_Barrier
+#define H_udo_runtime_Barrier
+//---------------------------------------------------------------------------
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// A sense-reversing barrier for a fixed number of threads. Waiting threads
+/// spin for a short time and then sleep on a futex, so short phases do not
+/// go through the kernel while long phases do not burn CPU time. The sense is
+/// a generation counter that is incremented whenever all threads arrived.
+class Barrier {
+   private:
+   /// The number of spin iterations before a thread goes to sleep
+   static constexpr unsigned spinIterations = 1u << 14;
+
+   /// The number of threads that take part in the barrier
+   uint32_t numThreads;
+   /// The number of threads that arrived in the current generation
+   alignas(64) std::atomic<uint32_t> arrived = 0;
+   /// The current generation, also used as the futex word
+   alignas(64) std::atomic<uint32_t> generation = 0;
+   /// The number of threads that sleep (or are about to sleep) on the futex
+   alignas(64) std::atomic<uint32_t> sleepers = 0;
+
+   /// Hint to the CPU that we are spinning
+   static void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+   }
+
+   /// Sleep until the generation is no longer the given value
+   void futexWait(uint32_t expected) {
+      ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&generation), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+   }
+   /// Wake all threads sleeping on the generation
+   void futexWakeAll() {
+      ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&generation), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+   }
+
+   public:
+   /// Constructor
+   explicit Barrier(uint32_t numThreads) : numThreads(numThreads) {}
+
+   Barrier(const Barrier&) = delete;
+   Barrier& operator=(const Barrier&) = delete;
+
+   /// Arrive at the barrier and wait until all other threads arrived. The
+   /// last thread to arrive runs the completion function before any thread
+   /// is released. Returns true for that thread.
+   template <typename F>
+   bool arriveAndWait(F&& completion) {
+      auto localGeneration = generation.load(std::memory_order_acquire);
+
+      if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == numThreads) {
+         completion();
+         arrived.store(0, std::memory_order_relaxed);
+         generation.store(localGeneration + 1, std::memory_order_seq_cst);
+         if (sleepers.load(std::memory_order_seq_cst) > 0)
+            futexWakeAll();
+         return true;
+      }
+
+      for (unsigned i = 0; i < spinIterations; ++i) {
+         if (generation.load(std::memory_order_acquire) != localGeneration)
+            return false;
+         pause();
+      }
+
+      sleepers.fetch_add(1, std::memory_order_seq_cst);
+      while (generation.load(std::memory_order_seq_cst) == localGeneration)
+         futexWait(localGeneration);
+      sleepers.fetch_sub(1, std::memory_order_relaxed);
+      return false;
+   }
+
+   /// Arrive at the barrier and wait until all other threads arrived
+   bool arriveAndWait() {
+      return arriveAndWait([] {});
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,141 @@
+#ifndef H_udo_runtime_Columns
+#define H_udo_runtime_Columns
+//---------------------------------------------------------------------------
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// The class and the type of a pointer to a data member
+template <auto member>
+struct MemberTraits;
+//---------------------------------------------------------------------------
+template <typename C, typename T, T C::*member>
+struct MemberTraits<member> {
+   /// The class that contains the member
+   using Class = C;
+   /// The type of the member
+   using Type = T;
+};
+//---------------------------------------------------------------------------
+/// A type-level description of the attributes of a tuple that should be
+/// delivered as columns. Every argument is a pointer to a data member of the
+/// tuple type, e.g. Columns<&Input::x, &Input::y>. Attributes that are not
+/// listed are never read by the runtime.
+template <auto... members>
+struct Columns {
+   static_assert(sizeof...(members) > 0, "at least one column is required");
+
+   /// The number of columns
+   static constexpr size_t numColumns = sizeof...(members);
+   /// The pointer to the member of the i-th column
+   template <size_t i>
+   static constexpr auto member = std::get<i>(std::tuple{members...});
+   /// The type of the i-th column
+   template <size_t i>
+   using Type = typename MemberTraits<member<i>>::Type;
+   /// The tuple type
+   using Tuple = typename MemberTraits<member<0>>::Class;
+
+   static_assert((std::is_same_v<typename MemberTraits<members>::Class, Tuple> && ...), "all columns must belong to the same tuple type");
+   static_assert((std::is_trivially_copyable_v<typename MemberTraits<members>::Type> && ...), "columns must be trivially copyable");
+
+   /// Call a function with the index of every column as integral constant
+   template <typename F>
+   static void forEachColumn(F&& function) {
+      [&]<size_t... i>(std::index_sequence<i...>) {
+         (function(std::integral_constant<size_t, i>()), ...);
+      }(std::make_index_sequence<numColumns>());
+   }
+};
+//---------------------------------------------------------------------------
+/// A range of tuples in columnar form, i.e. one contiguous array per column
+template <typename C>
+class ColumnMorsel {
+   private:
+   /// The pointers to the first value of every column
+   std::array<const void*, C::numColumns> columns;
+   /// The number of tuples
+   size_t numTuples;
+
+   public:
+   /// Constructor
+   ColumnMorsel(const std::array<const void*, C::numColumns>& columns, size_t numTuples) : columns(columns), numTuples(numTuples) {}
+
+   /// Get the number of tuples
+   size_t size() const { return numTuples; }
+
+   /// Get the values of the i-th column
+   template <size_t i>
+   std::span<const typename C::template Type<i>> column() const {
+      return {static_cast<const typename C::template Type<i>*>(columns[i]), numTuples};
+   }
+
+   /// Assemble a tuple from the columns. Attributes that have no column are
+   /// value-initialized.
+   typename C::Tuple getTuple(size_t index) const {
+      typename C::Tuple tuple{};
+      C::forEachColumn([&](auto i) { tuple.*(C::template member<i>) = column<i>()[index]; });
+      return tuple;
+   }
+};
+//---------------------------------------------------------------------------
+/// Tuples stored in columnar form
+template <typename C>
+class ColumnarInput {
+   private:
+   /// The values of every column
+   std::array<std::vector<std::byte>, C::numColumns> columns;
+   /// The number of tuples
+   size_t numTuples = 0;
+
+   public:
+   /// Constructor
+   ColumnarInput() = default;
+   /// Constructor for the given number of tuples
+   explicit ColumnarInput(size_t numTuples) : numTuples(numTuples) {
+      C::forEachColumn([&](auto i) { columns[i].resize(numTuples * sizeof(typename C::template Type<i>)); });
+   }
+
+   /// Create the columns from tuples
+   static ColumnarInput fromTuples(std::span<const typename C::Tuple> tuples) {
+      ColumnarInput input(tuples.size());
+      C::forEachColumn([&](auto i) {
+         auto column = input.template column<i>();
+         for (size_t j = 0; j < tuples.size(); ++j)
+            column[j] = tuples[j].*(C::template member<i>);
+      });
+      return input;
+   }
+
+   /// Get the number of tuples
+   size_t size() const { return numTuples; }
+
+   /// Get the values of the i-th column
+   template <size_t i>
+   std::span<typename C::template Type<i>> column() {
+      return {reinterpret_cast<typename C::template Type<i>*>(columns[i].data()), numTuples};
+   }
+   /// Get the values of the i-th column
+   template <size_t i>
+   std::span<const typename C::template Type<i>> column() const {
+      return {reinterpret_cast<const typename C::template Type<i>*>(columns[i].data()), numTuples};
+   }
+
+   /// Get the tuples in the range [begin, end)
+   ColumnMorsel<C> getMorsel(size_t begin, size_t end) const {
+      std::array<const void*, C::numColumns> morselColumns;
+      C::forEachColumn([&](auto i) { morselColumns[i] = column<i>().data() + begin; });
+      return {morselColumns, end - begin};
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
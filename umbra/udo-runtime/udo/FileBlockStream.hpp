@@ -0,0 +1,453 @@
+#ifndef H_udo_runtime_FileBlockStream
+#define H_udo_runtime_FileBlockStream
+//---------------------------------------------------------------------------
+#include "udo/UDOperator.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// A minimal io_uring that submits reads and waits for their completion. It
+/// uses the system calls directly, so it does not depend on liburing.
+class IoUring {
+   private:
+   /// The file descriptor of the ring, -1 if it could not be set up
+   int ringFd = -1;
+   /// The mapped submission queue ring
+   void* sqRing = MAP_FAILED;
+   /// The size of the submission queue ring mapping
+   size_t sqRingSize = 0;
+   /// The mapped completion queue ring, may be the same as sqRing
+   void* cqRing = MAP_FAILED;
+   /// The size of the completion queue ring mapping
+   size_t cqRingSize = 0;
+   /// The mapped submission queue entries
+   ::io_uring_sqe* sqes = static_cast<::io_uring_sqe*>(MAP_FAILED);
+   /// The number of submission queue entries
+   unsigned numSqes = 0;
+
+   /// The pointers into the submission queue ring
+   unsigned* sqTail = nullptr;
+   unsigned* sqMask = nullptr;
+   unsigned* sqArray = nullptr;
+   /// The pointers into the completion queue ring
+   unsigned* cqHead = nullptr;
+   unsigned* cqTail = nullptr;
+   unsigned* cqMask = nullptr;
+   ::io_uring_cqe* cqes = nullptr;
+
+   /// Get a pointer into a ring
+   template <typename T>
+   static T* at(void* ring, uint32_t offset) {
+      return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+   }
+
+   public:
+   /// Constructor
+   IoUring() = default;
+   /// Destructor
+   ~IoUring() {
+      if (sqes != MAP_FAILED)
+         ::munmap(sqes, numSqes * sizeof(::io_uring_sqe));
+      if (cqRing != MAP_FAILED && cqRing != sqRing)
+         ::munmap(cqRing, cqRingSize);
+      if (sqRing != MAP_FAILED)
+         ::munmap(sqRing, sqRingSize);
+      if (ringFd >= 0)
+         ::close(ringFd);
+   }
+
+   IoUring(const IoUring&) = delete;
+   IoUring& operator=(const IoUring&) = delete;
+
+   /// Set up a ring with the given number of entries. Returns the error if
+   /// io_uring is not available (old kernels, seccomp in containers) or 0.
+   int setup(unsigned numEntries) {
+      ::io_uring_params params = {};
+      ringFd = ::syscall(__NR_io_uring_setup, numEntries, &params);
+      if (ringFd < 0)
+         return errno;
+
+      sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(::io_uring_cqe);
+      if (params.features & IORING_FEAT_SINGLE_MMAP)
+         sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+      sqRing = ::mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+      if (sqRing == MAP_FAILED)
+         return errno;
+      if (params.features & IORING_FEAT_SINGLE_MMAP) {
+         cqRing = sqRing;
+      } else {
+         cqRing = ::mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+         if (cqRing == MAP_FAILED)
+            return errno;
+      }
+      numSqes = params.sq_entries;
+      sqes = static_cast<::io_uring_sqe*>(::mmap(nullptr, numSqes * sizeof(::io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+      if (sqes == MAP_FAILED)
+         return errno;
+
+      sqTail = at<unsigned>(sqRing, params.sq_off.tail);
+      sqMask = at<unsigned>(sqRing, params.sq_off.ring_mask);
+      sqArray = at<unsigned>(sqRing, params.sq_off.array);
+      cqHead = at<unsigned>(cqRing, params.cq_off.head);
+      cqTail = at<unsigned>(cqRing, params.cq_off.tail);
+      cqMask = at<unsigned>(cqRing, params.cq_off.ring_mask);
+      cqes = at<::io_uring_cqe>(cqRing, params.cq_off.cqes);
+      return 0;
+   }
+
+   /// Submit a read. The caller must not have more reads in flight than the
+   /// ring has entries.
+   bool submitRead(int fd, void* buffer, uint32_t size, uint64_t offset, uint64_t userData) {
+      auto tail = *sqTail;
+      auto index = tail & *sqMask;
+      auto& sqe = sqes[index];
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_READ;
+      sqe.fd = fd;
+      sqe.addr = reinterpret_cast<uintptr_t>(buffer);
+      sqe.len = size;
+      sqe.off = offset;
+      sqe.user_data = userData;
+      sqArray[index] = index;
+      __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+      return ::syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, nullptr, 0) == 1;
+   }
+
+   /// Wait until at least one read completed and call a function with the
+   /// user data and result of every completed read
+   template <typename F>
+   void waitForCompletions(F&& function) {
+      auto head = *cqHead;
+      while (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+         if (::syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+            printDebug("io_uring_enter failed, aborting\n");
+            abort();
+         }
+      }
+      auto tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+      for (; head != tail; ++head) {
+         auto& cqe = cqes[head & *cqMask];
+         function(cqe.user_data, cqe.res);
+      }
+      __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+   }
+};
+//---------------------------------------------------------------------------
+/// Reads a text file in large blocks that contain only whole lines. The
+/// reads of the next blocks are in flight while workers parse the blocks
+/// they got, so I/O and parsing overlap and at most numBuffers blocks are
+/// in memory. Reads go through io_uring and fall back to pread() when it is
+/// not available. Without io_uring, the reads are queued and done by the
+/// workers that release a block or wait for one, so they overlap with the
+/// parsing of the other workers. No lock is held while waiting for I/O. All
+/// functions are thread-safe.
+class FileBlockStream {
+   public:
+   /// The default size of a block
+   static constexpr size_t defaultBlockSize = 4ull << 20;
+   /// The maximum length of a line. A line that starts in one block and
+   /// ends in the next is copied in front of the next block.
+   static constexpr size_t maxLineLength = 64ull << 10;
+
+   /// A block of the file
+   struct Block {
+      /// The lines of the block. The data is followed by a null byte.
+      std::string_view data;
+      /// The index of the block in the file
+      uint64_t index;
+      /// The buffer slot of the block
+      size_t slot;
+   };
+
+   private:
+   /// The states of a buffer slot
+   enum class SlotState : uint8_t {
+      Free,
+      Queued,
+      Reading,
+      Ready,
+      InUse,
+   };
+
+   /// A buffer slot
+   struct Slot {
+      /// The state
+      SlotState state = SlotState::Free;
+      /// The block that is read into the slot
+      uint64_t blockIndex = 0;
+      /// The number of bytes read so far
+      uint64_t bytesRead = 0;
+   };
+
+   /// The mutex that protects the state
+   std::mutex mutex;
+   /// The condition variable on which workers wait until a slot is
+   /// released or read
+   std::condition_variable slotChanged;
+   /// The file
+   int fd = -1;
+   /// The size of the file
+   uint64_t fileSize = 0;
+   /// The size of a block
+   size_t blockSize = defaultBlockSize;
+   /// The number of blocks
+   uint64_t numBlocks = 0;
+   /// The memory of all buffers
+   char* buffers = nullptr;
+   /// The size of a buffer including the room for a partial line in front
+   /// and the null byte after it
+   size_t bufferSize = 0;
+   /// The buffer slots
+   std::vector<Slot> slots;
+   /// The next block to read
+   uint64_t nextRead = 0;
+   /// The next queued block that is read with pread(), without io_uring.
+   /// The blocks up to nextRead are queued.
+   uint64_t nextQueued = 0;
+   /// The next block to hand out
+   uint64_t nextBlock = 0;
+   /// The end of the last block that was handed out, i.e. the partial line
+   /// that belongs to the next block
+   std::string partialLine;
+   /// The ring, if io_uring is available
+   IoUring ring;
+   /// Is io_uring used?
+   bool useRing = false;
+   /// Is a worker waiting for completions of the ring?
+   bool reaping = false;
+   /// The completions of the ring that were collected by the reaping worker
+   std::vector<std::pair<uint64_t, int>> completions;
+
+   /// Get the position in a slot where the data of a block starts
+   char* getData(size_t slot) const {
+      return buffers + slot * bufferSize + maxLineLength;
+   }
+   /// Get the size of a block
+   uint64_t getBlockSize(uint64_t blockIndex) const {
+      return std::min<uint64_t>(blockSize, fileSize - blockIndex * blockSize);
+   }
+
+   /// Submit the read of the rest of a block
+   void submitRead(size_t slotIndex) {
+      auto& slot = slots[slotIndex];
+      auto remaining = getBlockSize(slot.blockIndex) - slot.bytesRead;
+      auto offset = slot.blockIndex * blockSize + slot.bytesRead;
+      if (!ring.submitRead(fd, getData(slotIndex) + slot.bytesRead, remaining, offset, slotIndex)) {
+         printDebug("io_uring read submission failed, aborting\n");
+         abort();
+      }
+   }
+
+   /// Start reading blocks into all free slots
+   void startReads() {
+      while (nextRead < numBlocks && nextRead < nextBlock + slots.size()) {
+         auto slotIndex = nextRead % slots.size();
+         auto& slot = slots[slotIndex];
+         if (slot.state != SlotState::Free)
+            break;
+         slot = {useRing ? SlotState::Reading : SlotState::Queued, nextRead, 0};
+         if (useRing)
+            submitRead(slotIndex);
+         ++nextRead;
+      }
+   }
+
+   /// Read the next queued block with pread(). The lock is released during
+   /// the read, so other workers can get and release blocks meanwhile.
+   void readQueuedBlock(std::unique_lock<std::mutex>& lock) {
+      auto slotIndex = nextQueued++ % slots.size();
+      auto& slot = slots[slotIndex];
+      slot.state = SlotState::Reading;
+      auto size = getBlockSize(slot.blockIndex);
+      auto offset = slot.blockIndex * blockSize;
+      auto* data = getData(slotIndex);
+
+      lock.unlock();
+      uint64_t bytesRead = 0;
+      while (bytesRead < size) {
+         auto result = ::pread(fd, data + bytesRead, size - bytesRead, offset + bytesRead);
+         if (result < 0 && errno == EINTR)
+            continue;
+         if (result <= 0) {
+            printDebug("reading the input file failed, aborting\n");
+            abort();
+         }
+         bytesRead += result;
+      }
+      lock.lock();
+
+      slot.bytesRead = bytesRead;
+      slot.state = SlotState::Ready;
+      slotChanged.notify_all();
+   }
+
+   /// Wait for completed reads of the ring. Only one worker reaps at a time
+   /// and the lock is released while it waits.
+   void reapCompletions(std::unique_lock<std::mutex>& lock) {
+      reaping = true;
+      lock.unlock();
+      completions.clear();
+      ring.waitForCompletions([&](uint64_t completedSlot, int result) { completions.emplace_back(completedSlot, result); });
+      lock.lock();
+      reaping = false;
+
+      for (auto [completedSlot, result] : completions) {
+         auto& completed = slots[completedSlot];
+         if (result <= 0) {
+            printDebug("reading the input file failed, aborting\n");
+            abort();
+         }
+         completed.bytesRead += result;
+         // Continue short reads
+         if (completed.bytesRead < getBlockSize(completed.blockIndex))
+            submitRead(completedSlot);
+         else
+            completed.state = SlotState::Ready;
+      }
+      slotChanged.notify_all();
+   }
+
+   /// Make progress while waiting for a slot: read a queued block, reap the
+   /// completions of the ring, or wait until another worker did so
+   void waitForRead(std::unique_lock<std::mutex>& lock) {
+      if (!useRing && nextQueued < nextRead)
+         readQueuedBlock(lock);
+      else if (useRing && !reaping)
+         reapCompletions(lock);
+      else
+         slotChanged.wait(lock);
+   }
+
+   public:
+   /// Constructor
+   FileBlockStream() = default;
+   /// Destructor
+   ~FileBlockStream() {
+      // Wait for all reads that are in flight before unmapping the buffers
+      if (useRing) {
+         std::unique_lock lock(mutex);
+         while (std::any_of(slots.begin(), slots.end(), [](const Slot& slot) { return slot.state == SlotState::Reading; }))
+            reapCompletions(lock);
+      }
+      if (buffers)
+         ::munmap(buffers, bufferSize * slots.size());
+      if (fd >= 0)
+         ::close(fd);
+   }
+
+   FileBlockStream(const FileBlockStream&) = delete;
+   FileBlockStream& operator=(const FileBlockStream&) = delete;
+
+   /// Open a file. Returns the error or 0.
+   int open(const char* fileName, size_t numBuffers, size_t blockSize = defaultBlockSize) {
+      fd = ::open(fileName, O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+         return errno;
+      struct ::stat fileStat = {};
+      if (::fstat(fd, &fileStat) < 0)
+         return errno;
+      ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+      fileSize = fileStat.st_size;
+      this->blockSize = std::max<size_t>(blockSize, 1);
+      numBlocks = (fileSize + this->blockSize - 1) / this->blockSize;
+      slots.resize(std::max<size_t>(numBuffers, 1));
+
+      bufferSize = (maxLineLength + this->blockSize + 1 + 4095) & ~4095ull;
+      void* memory = ::mmap(nullptr, bufferSize * slots.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (memory == MAP_FAILED)
+         return errno;
+      buffers = static_cast<char*>(memory);
+
+      useRing = ring.setup(slots.size()) == 0;
+      completions.reserve(slots.size());
+      std::unique_lock lock(mutex);
+      startReads();
+      return 0;
+   }
+
+   /// Does the stream use io_uring?
+   bool usesIoUring() const { return useRing; }
+
+   /// Get the next block. Blocks are handed out in file order. Returns
+   /// nullopt at the end of the file.
+   std::optional<Block> next() {
+      std::unique_lock lock(mutex);
+
+      // The slot may still be used by the block that was handed out
+      // numBuffers blocks before. Other workers may hand out blocks while
+      // the lock is released, so everything is checked again after waiting.
+      size_t slotIndex;
+      while (true) {
+         if (nextBlock >= numBlocks)
+            return std::nullopt;
+         startReads();
+         slotIndex = nextBlock % slots.size();
+         if (nextRead > nextBlock && slots[slotIndex].state == SlotState::Ready)
+            break;
+         if (nextRead > nextBlock)
+            waitForRead(lock);
+         else
+            slotChanged.wait(lock);
+      }
+      auto& slot = slots[slotIndex];
+
+      // Prepend the partial line of the previous block
+      char* begin = getData(slotIndex) - partialLine.size();
+      std::memcpy(begin, partialLine.data(), partialLine.size());
+      char* end = getData(slotIndex) + slot.bytesRead;
+
+      // Cut off the partial line at the end unless this is the last block
+      partialLine.clear();
+      if (nextBlock + 1 < numBlocks) {
+         char* lineEnd = end;
+         while (lineEnd != begin && lineEnd[-1] != '\n')
+            --lineEnd;
+         if (end - lineEnd > static_cast<ptrdiff_t>(maxLineLength) || lineEnd == begin) {
+            printDebug("line in the input file is too long, aborting\n");
+            abort();
+         }
+         partialLine.assign(lineEnd, end);
+         end = lineEnd;
+      }
+      *end = '\0';
+
+      slot.state = SlotState::InUse;
+      return Block{{begin, static_cast<size_t>(end - begin)}, nextBlock++, slotIndex};
+   }
+
+   /// Give a block back so that its buffer can be reused. Without io_uring,
+   /// the worker then reads the next queued block ahead.
+   void release(const Block& block) {
+      std::unique_lock lock(mutex);
+      slots[block.slot].state = SlotState::Free;
+      startReads();
+      slotChanged.notify_all();
+      if (!useRing && nextQueued < nextRead)
+         readQueuedBlock(lock);
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
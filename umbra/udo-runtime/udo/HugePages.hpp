@@ -0,0 +1,155 @@
+#ifndef H_udo_runtime_HugePages
+#define H_udo_runtime_HugePages
+//---------------------------------------------------------------------------
+#include "udo/UDOperator.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+#include <sys/mman.h>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// Whether mapped memory should use huge pages
+enum class HugePages {
+   /// Regular pages
+   None,
+   /// Transparent huge pages, if the kernel enables them with madvise()
+   Transparent,
+   /// Pages from the explicit huge page pool, falling back to transparent
+   /// huge pages when the pool is exhausted
+   Explicit,
+};
+//---------------------------------------------------------------------------
+/// The size of a huge page
+constexpr size_t hugePageSize = 2u << 20;
+/// The size of a regular page
+constexpr size_t smallPageSize = 4096;
+//---------------------------------------------------------------------------
+/// Get the size to which mappings are rounded up
+constexpr size_t getMappingGranularity(HugePages hugePages) {
+   return hugePages == HugePages::None ? smallPageSize : hugePageSize;
+}
+//---------------------------------------------------------------------------
+/// Map anonymous memory of the given size, which must be a multiple of
+/// getMappingGranularity(hugePages). The pages are only faulted in when they
+/// are touched. Sets isHugePage when the memory is backed by huge pages.
+/// Returns nullptr when no memory is available.
+inline void* mapMemory(size_t size, HugePages hugePages, bool& isHugePage) {
+   isHugePage = false;
+   if (hugePages == HugePages::Explicit) {
+      void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (memory != MAP_FAILED) {
+         isHugePage = true;
+         return memory;
+      }
+   }
+   if (hugePages == HugePages::None) {
+      void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      return memory == MAP_FAILED ? nullptr : memory;
+   }
+
+   // Transparent huge pages are only used for aligned ranges, so map more
+   // and cut off the unaligned ends
+   auto* memory = static_cast<std::byte*>(::mmap(nullptr, size + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+   if (memory == MAP_FAILED)
+      return nullptr;
+   auto* aligned = reinterpret_cast<std::byte*>((reinterpret_cast<uintptr_t>(memory) + hugePageSize - 1) & ~(hugePageSize - 1));
+   if (aligned != memory)
+      ::munmap(memory, aligned - memory);
+   if (auto tail = memory + size + hugePageSize - (aligned + size); tail > 0)
+      ::munmap(aligned + size, tail);
+   isHugePage = ::madvise(aligned, size, MADV_HUGEPAGE) == 0;
+   return aligned;
+}
+//---------------------------------------------------------------------------
+/// A fixed-size array of trivially copyable values in memory that is mapped
+/// directly, optionally with huge pages. Unlike std::vector, the values are
+/// not initialized, so a page is only faulted in and zeroed by the first
+/// thread that touches it. On NUMA systems, that places it on the node of
+/// this thread. See udo::allocateInputBuffer() to place the input of the
+/// standalone runtime on the workers that will consume it.
+template <typename T>
+class HugePageBuffer {
+   static_assert(std::is_trivially_copyable_v<T>, "buffers can only hold trivially copyable values");
+
+   private:
+   /// The values
+   T* values = nullptr;
+   /// The number of values
+   size_t numValues = 0;
+   /// The size of the mapping
+   size_t mappingSize = 0;
+
+   public:
+   /// Constructor
+   HugePageBuffer() = default;
+   /// Constructor for the given number of values
+   explicit HugePageBuffer(size_t size, HugePages hugePages = HugePages::Transparent) : numValues(size) {
+      if (size == 0)
+         return;
+      auto granularity = getMappingGranularity(hugePages);
+      mappingSize = (size * sizeof(T) + granularity - 1) & ~(granularity - 1);
+      bool isHugePage;
+      values = static_cast<T*>(mapMemory(mappingSize, hugePages, isHugePage));
+      if (!values) {
+         printDebug("out of memory for a buffer\n");
+         std::abort();
+      }
+   }
+   /// Destructor
+   ~HugePageBuffer() {
+      if (values)
+         ::munmap(values, mappingSize);
+   }
+
+   /// Move constructor
+   HugePageBuffer(HugePageBuffer&& other) noexcept
+      : values(std::exchange(other.values, nullptr)), numValues(std::exchange(other.numValues, 0)), mappingSize(std::exchange(other.mappingSize, 0)) {}
+   /// Move assignment
+   HugePageBuffer& operator=(HugePageBuffer&& other) noexcept {
+      std::swap(values, other.values);
+      std::swap(numValues, other.numValues);
+      std::swap(mappingSize, other.mappingSize);
+      return *this;
+   }
+
+   HugePageBuffer(const HugePageBuffer&) = delete;
+   HugePageBuffer& operator=(const HugePageBuffer&) = delete;
+
+   /// Get the values
+   T* data() { return values; }
+   /// Get the values
+   const T* data() const { return values; }
+   /// Get the number of values
+   size_t size() const { return numValues; }
+   /// Get a value
+   T& operator[](size_t index) { return values[index]; }
+   /// Get a value
+   const T& operator[](size_t index) const { return values[index]; }
+   /// Get the begin iterator
+   T* begin() { return values; }
+   /// Get the end iterator
+   T* end() { return values + numValues; }
+   /// Get the begin iterator
+   const T* begin() const { return values; }
+   /// Get the end iterator
+   const T* end() const { return values + numValues; }
+
+   /// Fault in the pages that contain the values in [begin, end), so that
+   /// they are placed on the NUMA node of the calling thread
+   void touch(size_t begin, size_t end) {
+      if (begin >= end)
+         return;
+      auto* first = reinterpret_cast<volatile std::byte*>(values + begin);
+      auto* last = reinterpret_cast<volatile std::byte*>(values + end);
+      for (auto* page = first; page < last; page += smallPageSize)
+         *page = std::byte(0);
+      *(last - 1) = std::byte(0);
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
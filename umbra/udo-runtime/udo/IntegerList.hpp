@@ -0,0 +1,171 @@
+#ifndef H_udo_runtime_IntegerList
+#define H_udo_runtime_IntegerList
+//---------------------------------------------------------------------------
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <system_error>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// A parser for comma-separated lists of integers, e.g. to unnest arrays
+/// that are stored as strings. The list is classified in blocks of 64 bytes
+/// with vector instructions into a bitmask of the commas and one of the
+/// bytes that are neither commas nor digits, so the fields are found and
+/// validated with bit operations. The digits of valid fields are converted
+/// 8 at a time with SWAR multiplications. The vector instructions are
+/// selected at compile time, AVX-512BW if available and SSE2 otherwise.
+class IntegerListParser {
+   private:
+   /// The number of bytes of a block
+   static constexpr size_t blockSize = 64;
+   /// The largest number of digits of an int64_t
+   static constexpr size_t maxDigits = 19;
+
+   /// Classify a block of up to 64 bytes into the commas and the bytes
+   /// that are neither commas nor digits
+   static void classifyBlock(const char* block, size_t size, uint64_t& commas, uint64_t& others) {
+#if defined(__AVX512BW__)
+      uint64_t valid = size >= blockSize ? ~0ull : (1ull << size) - 1;
+      // Masked loads do not fault on the masked bytes
+      auto bytes = _mm512_maskz_loadu_epi8(valid, block);
+      commas = _mm512_mask_cmpeq_epi8_mask(valid, bytes, _mm512_set1_epi8(','));
+      uint64_t digits = _mm512_cmple_epu8_mask(_mm512_sub_epi8(bytes, _mm512_set1_epi8('0')), _mm512_set1_epi8(9));
+      others = valid & ~digits & ~commas;
+#elif defined(__x86_64__)
+      // The last block of a list is copied so that no byte after it is read
+      alignas(16) char lastBlock[blockSize];
+      if (size < blockSize) {
+         std::memset(lastBlock, 0, sizeof(lastBlock));
+         std::memcpy(lastBlock, block, size);
+         block = lastBlock;
+      }
+      uint64_t valid = size >= blockSize ? ~0ull : (1ull << size) - 1;
+      uint64_t digits = 0;
+      commas = 0;
+      for (unsigned i = 0; i < blockSize; i += 16) {
+         auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+         auto values = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+         auto isDigit = _mm_cmpeq_epi8(_mm_min_epu8(values, _mm_set1_epi8(9)), values);
+         digits |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(isDigit))) << i;
+         commas |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(','))))) << i;
+      }
+      commas &= valid;
+      others = valid & ~digits & ~commas;
+#else
+      commas = 0;
+      others = 0;
+      for (size_t i = 0; i < size; ++i) {
+         commas |= static_cast<uint64_t>(block[i] == ',') << i;
+         others |= static_cast<uint64_t>(block[i] != ',' && static_cast<uint8_t>(block[i] - '0') > 9) << i;
+      }
+#endif
+   }
+
+   /// Get a mask of the lowest n bits, all bits for n >= 64
+   static uint64_t getLowBits(size_t n) {
+      return n >= blockSize ? ~0ull : (1ull << n) - 1;
+   }
+
+   /// Get the bits of the positions [begin, end) that are in the block at
+   /// base, with end >= base
+   static uint64_t getRangeMask(size_t begin, size_t end, size_t base) {
+      size_t blockBegin = begin > base ? begin - base : 0;
+      size_t blockEnd = std::min(end - base, blockSize);
+      return getLowBits(blockEnd) & ~getLowBits(blockBegin);
+   }
+
+   /// Convert 1 to 8 digits of the list [listBegin, listEnd)
+   static uint64_t parseDigits(const char* digits, size_t numDigits, const char* listBegin, const char* listEnd) {
+      // The digits are moved into the highest bytes of a word, so the lower
+      // bytes are leading zeros. The word is loaded as a whole, at the end of
+      // the list from the last 8 bytes of the list, so that no byte after
+      // the list is read.
+      uint64_t word;
+      size_t available = listEnd - digits;
+      if (available >= 8) [[likely]] {
+         std::memcpy(&word, digits, 8);
+      } else if (listEnd - listBegin >= 8) {
+         std::memcpy(&word, listEnd - 8, 8);
+         word >>= 8 * (8 - available);
+      } else {
+         word = 0;
+         for (size_t i = 0; i < numDigits; ++i)
+            word |= static_cast<uint64_t>(static_cast<uint8_t>(digits[i])) << (8 * i);
+      }
+      word <<= 8 * (8 - numDigits);
+      // Combine pairs of digits, then pairs of 2 digits, then of 4 digits
+      word = ((word & 0x0f0f0f0f0f0f0f0full) * (10 * 256 + 1)) >> 8;
+      word = ((word & 0x00ff00ff00ff00ffull) * (100 * 65536 + 1)) >> 16;
+      return ((word & 0x0000ffff0000ffffull) * (10000 * (1ull << 32) + 1)) >> 32;
+   }
+
+   /// Parse the field [begin, end) of a list of the given size and call
+   /// f(value, isValid). hasOthers tells if a byte after the first one is
+   /// not a digit.
+   template <typename F>
+   static void parseField(const char* list, size_t listSize, size_t begin, size_t end, bool hasOthers, F& f) {
+      auto first = list[begin];
+      bool isNegative = first == '-';
+      auto* digits = list + begin + isNegative;
+      size_t numDigits = list + end - digits;
+      // The conditions are combined without short-circuiting, so they do not
+      // branch
+      bool isValid = !hasOthers & (numDigits > 0) & (isNegative | (static_cast<uint8_t>(first - '0') <= 9));
+
+      if (numDigits > maxDigits) [[unlikely]] {
+         // Only leading zeros make such a number fit
+         int64_t value = 0;
+         auto result = std::from_chars(list + begin, list + end, value);
+         f(value, isValid && result.ec == std::errc() && result.ptr == list + end);
+         return;
+      }
+
+      // The first chunk has 1 to 8 digits, all others have 8. Fields
+      // without digits are invalid and parse their first byte instead.
+      size_t numFirstDigits = numDigits ? numDigits - 8 * ((numDigits - 1) / 8) : 1;
+      auto* listEnd = list + listSize;
+      uint64_t magnitude = parseDigits(numDigits ? digits : list + begin, numFirstDigits, list, listEnd);
+      for (auto* chunk = digits + numFirstDigits; chunk < list + end; chunk += 8)
+         magnitude = magnitude * 100000000 + parseDigits(chunk, 8, list, listEnd);
+      isValid &= magnitude <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + isNegative;
+      f(static_cast<int64_t>(isNegative ? 0 - magnitude : magnitude), isValid);
+   }
+
+   public:
+   /// Call f(value, isValid) for every field of a comma-separated list. A
+   /// field is valid if std::from_chars parses all of it into an int64_t,
+   /// the value of other fields is unspecified. The empty field after a
+   /// trailing comma is skipped. Callers can store every value and only
+   /// advance by isValid, so invalid fields cost no branch.
+   template <typename F>
+   static void parse(std::string_view list, F&& f) {
+      auto* data = list.data();
+      size_t fieldBegin = 0;
+      bool fieldHasOthers = false;
+      for (size_t base = 0; base < list.size(); base += blockSize) {
+         uint64_t commas, others;
+         classifyBlock(data + base, std::min(list.size() - base, blockSize), commas, others);
+         for (; commas; commas &= commas - 1) {
+            size_t fieldEnd = base + __builtin_ctzll(commas);
+            parseField(data, list.size(), fieldBegin, fieldEnd, fieldHasOthers | ((others & getRangeMask(fieldBegin + 1, fieldEnd, base)) != 0), f);
+            fieldBegin = fieldEnd + 1;
+            fieldHasOthers = false;
+         }
+         fieldHasOthers |= (others & getRangeMask(fieldBegin + 1, base + blockSize, base)) != 0;
+      }
+      if (fieldBegin < list.size())
+         parseField(data, list.size(), fieldBegin, list.size(), fieldHasOthers, f);
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,177 @@
+#ifndef H_udo_runtime_MorselScheduler
+#define H_udo_runtime_MorselScheduler
+//---------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// A morsel scheduler that partitions the input range between the workers.
+/// Every worker first consumes the range assigned to it and then steals
+/// morsels from other workers, preferring workers on the same NUMA node. The
+/// ranges of all workers of a node are adjacent, so most of the input is
+/// consumed on the node it was assigned to and no counter is shared by all
+/// workers.
+///
+/// The morsel size is either fixed or adaptive. Adaptive morsels are sized
+/// per worker from the measured cost per tuple so that a morsel takes about
+/// targetMorselDuration, and they shrink towards the end of a range so that
+/// the workers finish at roughly the same time.
+class MorselScheduler {
+   public:
+   /// The morsel size that selects adaptive morsels
+   static constexpr size_t adaptiveMorselSize = 0;
+   /// The time an adaptive morsel should take in nanoseconds
+   static constexpr uint64_t targetMorselDuration = 200'000;
+   /// The size of the first adaptive morsel of a worker
+   static constexpr size_t initialMorselSize = 1024;
+   /// The minimum size of an adaptive morsel
+   static constexpr size_t minMorselSize = 16;
+   /// The maximum size of an adaptive morsel
+   static constexpr size_t maxMorselSize = 1u << 20;
+
+   /// A range of input indexes
+   struct Morsel {
+      /// The first index of the morsel
+      uint64_t begin;
+      /// The index after the last index of the morsel
+      uint64_t end;
+   };
+
+   private:
+   /// The input range of a single worker. Every range has its own cache line
+   /// so that only stealing workers ever touch a foreign range.
+   struct alignas(64) WorkerRange {
+      /// The next index that was not handed out yet
+      std::atomic<uint64_t> next = 0;
+      /// The end of the range
+      uint64_t end = 0;
+      /// The position in the steal order from which stealing continues. Only
+      /// used by the owner of the range.
+      size_t stealPosition = 0;
+      /// The adaptive morsel size of the owner
+      size_t morselSize = initialMorselSize;
+      /// The estimated cost per tuple of the owner in nanoseconds, 0 when
+      /// nothing was measured yet
+      double tupleCost = 0;
+   };
+
+   /// The number of workers
+   size_t numWorkers;
+   /// The morsel size, or adaptiveMorselSize
+   size_t morselSize;
+   /// The ranges of all workers
+   std::unique_ptr<WorkerRange[]> ranges;
+   /// The order in which workers are assigned a range, grouped by node
+   std::vector<uint32_t> rangeOrder;
+   /// The workers from which each worker steals, same node first. Stored as
+   /// numWorkers consecutive lists of numWorkers - 1 entries.
+   std::vector<uint32_t> stealOrder;
+
+   /// Claim a morsel for a worker from a range
+   std::optional<Morsel> claim(WorkerRange& range, const WorkerRange& ownRange) const {
+      auto next = range.next.load(std::memory_order_relaxed);
+      if (next >= range.end)
+         return std::nullopt;
+
+      uint64_t size = morselSize;
+      if (size == adaptiveMorselSize) {
+         // Take at most a quarter of the rest, so that the last morsels of a
+         // range are small and can be balanced between the workers
+         size = std::clamp<uint64_t>((range.end - next) / 4, minMorselSize, ownRange.morselSize);
+      }
+
+      auto begin = range.next.fetch_add(size, std::memory_order_relaxed);
+      if (begin >= range.end)
+         return std::nullopt;
+      return Morsel{begin, std::min<uint64_t>(begin + size, range.end)};
+   }
+
+   public:
+   /// Constructor. workerNodes contains the NUMA node of every worker.
+   MorselScheduler(std::span<const unsigned> workerNodes, size_t morselSize)
+      : numWorkers(std::max<size_t>(workerNodes.size(), 1)), morselSize(morselSize), ranges(new WorkerRange[numWorkers]) {
+      auto nodeOf = [&](size_t worker) { return worker < workerNodes.size() ? workerNodes[worker] : 0u; };
+
+      rangeOrder.resize(numWorkers);
+      for (size_t i = 0; i < numWorkers; ++i)
+         rangeOrder[i] = i;
+      std::stable_sort(rangeOrder.begin(), rangeOrder.end(), [&](uint32_t a, uint32_t b) { return nodeOf(a) < nodeOf(b); });
+
+      // Every worker steals from the workers on its own node first, starting
+      // with its neighbor so that thieves spread over different victims.
+      stealOrder.reserve(numWorkers * (numWorkers - 1));
+      for (size_t worker = 0; worker < numWorkers; ++worker) {
+         for (size_t sameNode = 0; sameNode < 2; ++sameNode) {
+            for (size_t i = 1; i < numWorkers; ++i) {
+               auto victim = (worker + i) % numWorkers;
+               if ((nodeOf(victim) == nodeOf(worker)) == (sameNode == 0))
+                  stealOrder.push_back(victim);
+            }
+         }
+      }
+   }
+
+   /// Partition a new input of the given size between the workers
+   void reset(uint64_t inputSize) {
+      uint64_t begin = 0;
+      for (size_t i = 0; i < numWorkers; ++i) {
+         auto& range = ranges[rangeOrder[i]];
+         uint64_t end = inputSize * (i + 1) / numWorkers;
+         range.next.store(begin, std::memory_order_relaxed);
+         range.end = end;
+         range.stealPosition = 0;
+         range.morselSize = initialMorselSize;
+         range.tupleCost = 0;
+         begin = end;
+      }
+   }
+
+   /// Get the range that reset() assigns to a worker for an input of the
+   /// given size. The worker processes it unless other workers steal from it.
+   Morsel getPartition(size_t workerId, uint64_t inputSize) const {
+      auto i = std::find(rangeOrder.begin(), rangeOrder.end(), workerId) - rangeOrder.begin();
+      return Morsel{inputSize * i / numWorkers, inputSize * (i + 1) / numWorkers};
+   }
+
+   /// Get the next morsel for a worker
+   std::optional<Morsel> next(size_t workerId) {
+      auto& ownRange = ranges[workerId];
+      if (auto morsel = claim(ownRange, ownRange))
+         return morsel;
+
+      auto victims = std::span(stealOrder).subspan(workerId * (numWorkers - 1), numWorkers - 1);
+      for (; ownRange.stealPosition < victims.size(); ++ownRange.stealPosition)
+         if (auto morsel = claim(ranges[victims[ownRange.stealPosition]], ownRange))
+            return morsel;
+
+      return std::nullopt;
+   }
+
+   /// Are the morsels sized adaptively?
+   bool isAdaptive() const { return morselSize == adaptiveMorselSize; }
+
+   /// Report how long a worker took for a morsel, so that its next morsels
+   /// can be sized to take about targetMorselDuration
+   void reportMorsel(size_t workerId, Morsel morsel, uint64_t duration) {
+      auto numTuples = morsel.end - morsel.begin;
+      if (!isAdaptive() || numTuples == 0)
+         return;
+
+      // Smooth the cost per tuple over the last morsels, so that a single
+      // interrupted morsel does not shrink the following ones too much
+      auto& ownRange = ranges[workerId];
+      double cost = static_cast<double>(std::max<uint64_t>(duration, 1)) / numTuples;
+      ownRange.tupleCost = ownRange.tupleCost == 0 ? cost : 0.75 * ownRange.tupleCost + 0.25 * cost;
+      ownRange.morselSize = std::clamp<uint64_t>(targetMorselDuration / ownRange.tupleCost, minMorselSize, maxMorselSize);
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,331 @@
+#ifndef H_udo_runtime_MultiStringSearch
+#define H_udo_runtime_MultiStringSearch
+//---------------------------------------------------------------------------
+#include "udo/StringSearch.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <vector>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// The implementations of the multi-pattern search
+enum class MultiSearchKernel {
+   /// A deterministic Aho-Corasick automaton, for any number of patterns
+   AhoCorasick,
+   /// The Teddy filter with AVX2, for few patterns of at least 3 bytes
+   Teddy,
+};
+//---------------------------------------------------------------------------
+/// Get the name of a multi-pattern search kernel
+inline const char* getMultiSearchKernelName(MultiSearchKernel kernel) {
+   switch (kernel) {
+      case MultiSearchKernel::AhoCorasick: return "aho-corasick";
+      case MultiSearchKernel::Teddy: return "teddy";
+   }
+   __builtin_unreachable();
+}
+//---------------------------------------------------------------------------
+/// A case-insensitive search for many patterns at once that are fixed at
+/// construction, see FoldedPattern. Every text is scanned once no matter how
+/// many patterns there are. Small sets of patterns use Teddy, which finds
+/// candidate positions with nibble lookup tables in vector registers and
+/// verifies the patterns of the matching buckets. Larger sets use an
+/// Aho-Corasick automaton whose transitions are a dense table over classes
+/// of case-folded bytes, so every byte costs two loads.
+class CaseInsensitiveMultiSearch {
+   public:
+   /// The largest number of patterns for Teddy
+   static constexpr size_t maxTeddyPatterns = 32;
+   /// The number of buckets of Teddy
+   static constexpr unsigned numTeddyBuckets = 8;
+   /// The number of bytes of the Teddy fingerprint, which is also the
+   /// minimum size of the patterns for Teddy
+   static constexpr unsigned teddyFingerprintSize = 3;
+
+   private:
+   /// The flag in a transition of the automaton for states with matches
+   static constexpr uint32_t matchFlag = 1u << 31;
+
+   /// The patterns
+   std::vector<FoldedPattern> patterns;
+   /// The kernel
+   MultiSearchKernel kernel;
+
+   /// The class of every byte for the automaton. Both cases of a letter have
+   /// the same class, bytes that do not occur in any pattern have class 0.
+   std::array<uint8_t, 256> byteClasses = {};
+   /// The number of byte classes
+   uint32_t numClasses = 1;
+   /// The transitions of the automaton. Every state has numClasses entries,
+   /// an entry is the offset of the next state's entries, with matchFlag
+   /// when the next state has matches.
+   std::vector<uint32_t> transitions;
+   /// The first entry of every state in matchingPatterns
+   std::vector<uint32_t> matchBegins;
+   /// The patterns that end in every state, including the patterns of its
+   /// suffix states
+   std::vector<uint32_t> matchingPatterns;
+
+   /// The bucket masks of Teddy for the low nibbles of every fingerprint byte
+   alignas(32) std::array<std::array<uint8_t, 16>, teddyFingerprintSize> lowNibbleMasks = {};
+   /// The bucket masks of Teddy for the high nibbles of every fingerprint byte
+   alignas(32) std::array<std::array<uint8_t, 16>, teddyFingerprintSize> highNibbleMasks = {};
+   /// The patterns of every bucket
+   std::array<std::vector<uint32_t>, numTeddyBuckets> buckets;
+
+   /// Build the Aho-Corasick automaton
+   void buildAutomaton() {
+      for (auto& pattern : patterns) {
+         for (size_t i = 0; i < pattern.size(); ++i) {
+            uint8_t c = pattern.getByte(i);
+            if (byteClasses[c])
+               continue;
+            byteClasses[c] = numClasses;
+            if (pattern.getFold(i))
+               byteClasses[c & ~0x20] = numClasses;
+            ++numClasses;
+         }
+      }
+
+      // Build the trie, missing transitions are noState
+      static constexpr uint32_t noState = ~0u;
+      std::vector<uint32_t> trie(numClasses, noState);
+      std::vector<std::vector<uint32_t>> ownMatches(1);
+      for (uint32_t patternId = 0; patternId < patterns.size(); ++patternId) {
+         auto& pattern = patterns[patternId];
+         if (pattern.size() == 0)
+            continue;
+         uint32_t state = 0;
+         for (size_t i = 0; i < pattern.size(); ++i) {
+            auto& next = trie[state * numClasses + byteClasses[pattern.getByte(i)]];
+            if (next == noState) {
+               next = ownMatches.size();
+               ownMatches.emplace_back();
+               trie.resize(trie.size() + numClasses, noState);
+            }
+            state = trie[state * numClasses + byteClasses[pattern.getByte(i)]];
+         }
+         ownMatches[state].push_back(patternId);
+      }
+
+      // Complete the transitions with the failure links in breadth-first
+      // order, so that the transitions of shorter suffixes are complete
+      auto numStates = ownMatches.size();
+      std::vector<uint32_t> failure(numStates, 0);
+      std::vector<std::vector<uint32_t>> matches(numStates);
+      std::vector<uint32_t> queue;
+      queue.reserve(numStates);
+      for (uint32_t c = 0; c < numClasses; ++c) {
+         if (trie[c] == noState) {
+            trie[c] = 0;
+         } else {
+            queue.push_back(trie[c]);
+         }
+      }
+      matches[0] = ownMatches[0];
+      for (size_t i = 0; i < queue.size(); ++i) {
+         auto state = queue[i];
+         matches[state] = ownMatches[state];
+         auto& suffixMatches = matches[failure[state]];
+         matches[state].insert(matches[state].end(), suffixMatches.begin(), suffixMatches.end());
+         for (uint32_t c = 0; c < numClasses; ++c) {
+            auto& next = trie[state * numClasses + c];
+            auto suffixNext = trie[failure[state] * numClasses + c];
+            if (next == noState) {
+               next = suffixNext;
+            } else {
+               failure[next] = suffixNext;
+               queue.push_back(next);
+            }
+         }
+      }
+
+      transitions.resize(trie.size());
+      for (size_t i = 0; i < trie.size(); ++i)
+         transitions[i] = trie[i] * numClasses | (matches[trie[i]].empty() ? 0 : matchFlag);
+      matchBegins.reserve(numStates + 1);
+      for (auto& stateMatches : matches) {
+         matchBegins.push_back(matchingPatterns.size());
+         matchingPatterns.insert(matchingPatterns.end(), stateMatches.begin(), stateMatches.end());
+      }
+      matchBegins.push_back(matchingPatterns.size());
+   }
+
+   /// Build the Teddy masks
+   void buildTeddy() {
+      for (uint32_t patternId = 0; patternId < patterns.size(); ++patternId) {
+         auto& pattern = patterns[patternId];
+         auto bucket = patternId % numTeddyBuckets;
+         buckets[bucket].push_back(patternId);
+         for (unsigned i = 0; i < teddyFingerprintSize; ++i) {
+            // Both cases of a letter differ only in the high nibble
+            uint8_t c = pattern.getByte(i);
+            lowNibbleMasks[i][c & 0xf] |= 1 << bucket;
+            highNibbleMasks[i][c >> 4] |= 1 << bucket;
+            if (pattern.getFold(i))
+               highNibbleMasks[i][(c & ~0x20) >> 4] |= 1 << bucket;
+         }
+      }
+   }
+
+   /// Search with the automaton. f(patternId) returns true to stop the
+   /// search. Returns true if the search was stopped.
+   template <typename F>
+   bool searchAutomaton(std::string_view text, F& f) const {
+      uint32_t state = 0;
+      for (auto c : text) {
+         auto transition = transitions[state + byteClasses[static_cast<uint8_t>(c)]];
+         state = transition & ~matchFlag;
+         if (transition & matchFlag) [[unlikely]] {
+            auto stateId = state / numClasses;
+            for (auto i = matchBegins[stateId]; i < matchBegins[stateId + 1]; ++i)
+               if (f(matchingPatterns[i]))
+                  return true;
+         }
+      }
+      return false;
+   }
+
+#if defined(__x86_64__)
+   /// Verify the candidates of a Teddy block. The bucket bits of the
+   /// positions in the block are in candidateBuckets.
+   template <typename F>
+   bool verifyTeddyCandidates(std::string_view text, size_t begin, uint32_t candidates, const uint8_t* candidateBuckets, F& f) const {
+      while (candidates) {
+         auto offset = __builtin_ctz(candidates);
+         candidates &= candidates - 1;
+         auto position = begin + offset;
+         for (unsigned bucketMask = candidateBuckets[offset]; bucketMask; bucketMask &= bucketMask - 1) {
+            for (auto patternId : buckets[__builtin_ctz(bucketMask)]) {
+               auto& pattern = patterns[patternId];
+               if (position + pattern.size() <= text.size() && pattern.matchesAt(text.data() + position, text.data() + text.size()))
+                  if (f(patternId))
+                     return true;
+            }
+         }
+      }
+      return false;
+   }
+
+   /// Get the buckets whose fingerprints match at the 32 positions of a block
+   __attribute__((target("avx2"), always_inline)) __m256i matchTeddyBlock(const char* block, const __m256i* lowMasks, const __m256i* highMasks) const {
+      auto nibbleMask = _mm256_set1_epi8(0xf);
+      auto result = _mm256_set1_epi8(-1);
+      for (unsigned i = 0; i < teddyFingerprintSize; ++i) {
+         auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+         auto low = _mm256_shuffle_epi8(lowMasks[i], _mm256_and_si256(bytes, nibbleMask));
+         auto high = _mm256_shuffle_epi8(highMasks[i], _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibbleMask));
+         result = _mm256_and_si256(result, _mm256_and_si256(low, high));
+      }
+      return result;
+   }
+
+   /// Search with Teddy. f(patternId) returns true to stop the search.
+   /// Returns true if the search was stopped.
+   template <typename F>
+   __attribute__((target("avx2"))) bool searchTeddy(std::string_view text, F& f) const {
+      if (text.size() < teddyFingerprintSize)
+         return false;
+      __m256i lowMasks[teddyFingerprintSize], highMasks[teddyFingerprintSize];
+      for (unsigned i = 0; i < teddyFingerprintSize; ++i) {
+         lowMasks[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lowNibbleMasks[i].data())));
+         highMasks[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(highNibbleMasks[i].data())));
+      }
+
+      auto numPositions = text.size() - teddyFingerprintSize + 1;
+      size_t i = 0;
+      alignas(32) uint8_t candidateBuckets[32];
+      for (; i + 32 + teddyFingerprintSize - 1 <= text.size(); i += 32) {
+         auto blockBuckets = matchTeddyBlock(text.data() + i, lowMasks, highMasks);
+         uint32_t candidates = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(blockBuckets, _mm256_setzero_si256())));
+         if (candidates) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(candidateBuckets), blockBuckets);
+            if (verifyTeddyCandidates(text, i, candidates, candidateBuckets, f))
+               return true;
+         }
+      }
+      if (i < numPositions) {
+         // The last positions are matched in a zero-padded copy, so that no
+         // byte after the text is read
+         alignas(32) char tail[64];
+         copyToPaddedBlock(tail, text.data() + i, text.size() - i);
+         auto blockBuckets = matchTeddyBlock(tail, lowMasks, highMasks);
+         uint32_t candidates = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(blockBuckets, _mm256_setzero_si256())));
+         candidates &= (1ull << (numPositions - i)) - 1;
+         if (candidates) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(candidateBuckets), blockBuckets);
+            if (verifyTeddyCandidates(text, i, candidates, candidateBuckets, f))
+               return true;
+         }
+      }
+      return false;
+   }
+#endif
+
+   /// Search a text. f(patternId) returns true to stop the search.
+   template <typename F>
+   bool search(std::string_view text, F& f) const {
+#if defined(__x86_64__)
+      if (kernel == MultiSearchKernel::Teddy)
+         return searchTeddy(text, f);
+#endif
+      return searchAutomaton(text, f);
+   }
+
+   public:
+   /// Constructor. Uses Teddy if the patterns and the CPU allow it and the
+   /// automaton otherwise. Empty patterns never match.
+   explicit CaseInsensitiveMultiSearch(std::span<const std::string_view> patterns)
+      : CaseInsensitiveMultiSearch(patterns, isTeddySupported(patterns) ? MultiSearchKernel::Teddy : MultiSearchKernel::AhoCorasick) {}
+   /// Constructor with a kernel, which must be supported for the patterns
+   CaseInsensitiveMultiSearch(std::span<const std::string_view> patterns, MultiSearchKernel kernel) : kernel(kernel) {
+      this->patterns.reserve(patterns.size());
+      for (auto pattern : patterns)
+         this->patterns.emplace_back(pattern);
+      if (kernel == MultiSearchKernel::Teddy)
+         buildTeddy();
+      else
+         buildAutomaton();
+   }
+
+   /// Can Teddy be used for the patterns on the current CPU?
+   static bool isTeddySupported(std::span<const std::string_view> patterns) {
+      if (patterns.empty() || patterns.size() > maxTeddyPatterns || !isSearchKernelSupported(SearchKernel::AVX2))
+         return false;
+      return std::all_of(patterns.begin(), patterns.end(), [](std::string_view pattern) { return pattern.size() >= teddyFingerprintSize; });
+   }
+
+   /// Get the kernel
+   MultiSearchKernel getKernel() const { return kernel; }
+   /// Get the number of patterns
+   size_t getNumPatterns() const { return patterns.size(); }
+
+   /// Call f(patternId) for every occurrence of a pattern in a text. The
+   /// occurrences are not ordered.
+   template <typename F>
+   void forEachMatch(std::string_view text, F&& f) const {
+      auto report = [&](uint32_t patternId) {
+         f(patternId);
+         return false;
+      };
+      search(text, report);
+   }
+
+   /// Does any pattern occur in a text?
+   bool containsAny(std::string_view text) const {
+      auto stop = [](uint32_t) { return true; };
+      return search(text, stop);
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
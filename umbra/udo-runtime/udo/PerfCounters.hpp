@@ -0,0 +1,273 @@
+#ifndef H_udo_runtime_PerfCounters
+#define H_udo_runtime_PerfCounters
+//---------------------------------------------------------------------------
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// The hardware counters that are sampled
+enum class PerfCounter : uint8_t {
+   Cycles,
+   Instructions,
+   LLCMisses,
+   BranchMisses,
+   StalledCycles,
+};
+//---------------------------------------------------------------------------
+struct PerfReading;
+//---------------------------------------------------------------------------
+/// The values of all counters. Counters that are not available are ~0.
+struct PerfValues {
+   /// The number of counters
+   static constexpr size_t numCounters = 5;
+   /// The value that marks an unavailable counter
+   static constexpr uint64_t unavailable = ~0ull;
+
+   /// The values indexed by PerfCounter
+   std::array<uint64_t, numCounters> values;
+
+   /// Constructor
+   PerfValues() { values.fill(unavailable); }
+
+   /// Get a value
+   uint64_t operator[](PerfCounter counter) const { return values[static_cast<size_t>(counter)]; }
+
+   /// Add the difference between two readings, see PerfReading
+   void addDelta(const PerfReading& begin, const PerfReading& end);
+   /// Add other values
+   void add(const PerfValues& other) {
+      for (size_t i = 0; i < numCounters; ++i) {
+         if (other.values[i] == unavailable)
+            continue;
+         if (values[i] == unavailable)
+            values[i] = 0;
+         values[i] += other.values[i];
+      }
+   }
+};
+//---------------------------------------------------------------------------
+/// A reading of a counter group. The values are the raw counts, which only
+/// grow. When the kernel multiplexes the group with other events, it counts
+/// only while the group is running, so the difference of two readings is
+/// extrapolated with the times between them.
+struct PerfReading {
+   /// The raw values
+   PerfValues values;
+   /// The time the group was enabled
+   uint64_t timeEnabled = 0;
+   /// The time the group was running, i.e. counting
+   uint64_t timeRunning = 0;
+};
+//---------------------------------------------------------------------------
+inline void PerfValues::addDelta(const PerfReading& begin, const PerfReading& end) {
+   // The group did not count in between, so there is nothing to attribute
+   if (end.timeRunning <= begin.timeRunning)
+      return;
+   auto timeEnabled = end.timeEnabled - begin.timeEnabled;
+   auto timeRunning = end.timeRunning - begin.timeRunning;
+   for (size_t i = 0; i < numCounters; ++i) {
+      if (begin.values.values[i] == unavailable || end.values.values[i] == unavailable)
+         continue;
+      if (values[i] == unavailable)
+         values[i] = 0;
+      auto delta = end.values.values[i] - begin.values.values[i];
+      if (timeRunning < timeEnabled)
+         delta = static_cast<uint64_t>(static_cast<double>(delta) * timeEnabled / timeRunning);
+      values[i] += delta;
+   }
+}
+//---------------------------------------------------------------------------
+/// A group of hardware counters that count the user-space events of the
+/// calling thread. Counters the CPU or the kernel do not provide (e.g. in
+/// containers or VMs without a virtual PMU) are skipped, so the group may
+/// count a subset of the counters or nothing at all.
+class PerfCounterGroup {
+   private:
+   /// The file descriptor of the group leader, or -1 when the group could
+   /// not be opened
+   int leaderFd = -1;
+   /// The file descriptors of all counters in the group, -1 for unavailable
+   /// counters
+   std::array<int, PerfValues::numCounters> fds;
+   /// The counter of every value in the group read format
+   std::vector<PerfCounter> groupOrder;
+
+   /// Get the perf_event configuration of a counter
+   static uint64_t getConfig(PerfCounter counter) {
+      switch (counter) {
+         case PerfCounter::Cycles: return PERF_COUNT_HW_CPU_CYCLES;
+         case PerfCounter::Instructions: return PERF_COUNT_HW_INSTRUCTIONS;
+         case PerfCounter::LLCMisses: return PERF_COUNT_HW_CACHE_MISSES;
+         case PerfCounter::BranchMisses: return PERF_COUNT_HW_BRANCH_MISSES;
+         case PerfCounter::StalledCycles: return PERF_COUNT_HW_STALLED_CYCLES_BACKEND;
+      }
+      __builtin_unreachable();
+   }
+
+   public:
+   /// Constructor. Opens the counters for the calling thread and starts
+   /// them.
+   PerfCounterGroup() {
+      fds.fill(-1);
+      for (size_t i = 0; i < PerfValues::numCounters; ++i) {
+         auto counter = static_cast<PerfCounter>(i);
+         ::perf_event_attr attr = {};
+         attr.size = sizeof(attr);
+         attr.type = PERF_TYPE_HARDWARE;
+         attr.config = getConfig(counter);
+         attr.disabled = leaderFd < 0;
+         attr.exclude_kernel = 1;
+         attr.exclude_hv = 1;
+         attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+         int fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, leaderFd, 0);
+         if (fd < 0)
+            continue;
+         if (leaderFd < 0)
+            leaderFd = fd;
+         fds[i] = fd;
+         groupOrder.push_back(counter);
+      }
+      if (leaderFd >= 0)
+         ::ioctl(leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+   }
+   /// Destructor
+   ~PerfCounterGroup() {
+      for (int fd : fds)
+         if (fd >= 0)
+            ::close(fd);
+   }
+
+   PerfCounterGroup(const PerfCounterGroup&) = delete;
+   PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+   /// Could any counter be opened?
+   bool isAvailable() const { return leaderFd >= 0; }
+
+   /// Read the current raw values and times
+   PerfReading read() const {
+      PerfReading result;
+      if (leaderFd < 0)
+         return result;
+
+      std::array<uint64_t, 3 + PerfValues::numCounters> buffer;
+      if (::read(leaderFd, buffer.data(), sizeof(buffer)) < static_cast<ssize_t>((3 + groupOrder.size()) * sizeof(uint64_t)))
+         return result;
+      result.timeEnabled = buffer[1];
+      result.timeRunning = buffer[2];
+      for (size_t i = 0; i < groupOrder.size() && i < buffer[0]; ++i)
+         result.values.values[static_cast<size_t>(groupOrder[i])] = buffer[3 + i];
+      return result;
+   }
+
+   /// Check whether hardware counters can be opened at all. Returns the
+   /// error of perf_event_open() if not, or 0.
+   static int probe() {
+      ::perf_event_attr attr = {};
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      attr.disabled = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      int fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+      if (fd < 0)
+         return errno;
+      ::close(fd);
+      return 0;
+   }
+};
+//---------------------------------------------------------------------------
+/// The counter values of all workers attributed to phases of the execution.
+/// A phase is identified by a 64-bit key chosen by the caller. Every worker
+/// accumulates into its own map, so recording needs no synchronization.
+class PerfProfile {
+   private:
+   /// The state of a worker
+   struct alignas(64) WorkerProfile {
+      /// The values per phase
+      std::map<uint64_t, PerfValues> phases;
+      /// The last reading
+      PerfReading lastReading;
+   };
+
+   /// The profiles of all workers
+   std::vector<WorkerProfile> workers;
+
+   public:
+   /// Start a new profile for the given number of workers
+   void begin(size_t numWorkers) {
+      workers.clear();
+      workers.resize(numWorkers);
+   }
+
+   /// Set the reading a worker starts with
+   void start(size_t workerId, const PerfCounterGroup& group) {
+      workers[workerId].lastReading = group.read();
+   }
+
+   /// Attribute the counter values since the last reading to a phase
+   void attribute(size_t workerId, const PerfCounterGroup& group, uint64_t phase) {
+      auto& worker = workers[workerId];
+      auto reading = group.read();
+      worker.phases[phase].addDelta(worker.lastReading, reading);
+      worker.lastReading = reading;
+   }
+
+   /// Is the profile empty?
+   bool empty() const {
+      for (auto& worker : workers)
+         if (!worker.phases.empty())
+            return false;
+      return true;
+   }
+
+   /// Print the counters per phase summed over all workers. The phases are
+   /// named by the given function.
+   template <typename F>
+   void print(std::ostream& out, F&& getPhaseName) const {
+      std::map<uint64_t, PerfValues> phases;
+      for (auto& worker : workers)
+         for (auto& [phase, values] : worker.phases)
+            phases[phase].add(values);
+
+      auto printValue = [&](uint64_t value, int width) {
+         if (value == PerfValues::unavailable)
+            out << std::setw(width) << "n/a";
+         else
+            out << std::setw(width) << value;
+      };
+
+      out << std::left << std::setw(28) << "phase" << std::right << std::setw(16) << "cycles" << std::setw(16) << "instructions" << std::setw(8) << "ipc" << std::setw(14) << "llc_misses" << std::setw(14) << "branch_misses" << std::setw(16) << "stalled_cycles" << '\n';
+      for (auto& [phase, values] : phases) {
+         out << std::left << std::setw(28) << std::string(getPhaseName(phase)) << std::right;
+         printValue(values[PerfCounter::Cycles], 16);
+         printValue(values[PerfCounter::Instructions], 16);
+         auto cycles = values[PerfCounter::Cycles];
+         auto instructions = values[PerfCounter::Instructions];
+         if (cycles == PerfValues::unavailable || instructions == PerfValues::unavailable || cycles == 0)
+            out << std::setw(8) << "n/a";
+         else
+            out << std::fixed << std::setprecision(2) << std::setw(8) << static_cast<double>(instructions) / cycles << std::defaultfloat;
+         printValue(values[PerfCounter::LLCMisses], 14);
+         printValue(values[PerfCounter::BranchMisses], 14);
+         printValue(values[PerfCounter::StalledCycles], 16);
+         out << '\n';
+      }
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,153 @@
+#ifndef H_udo_runtime_Random
+#define H_udo_runtime_Random
+//---------------------------------------------------------------------------
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// A fast pseudo random number generator for UDOs. It runs four independent
+/// xoshiro256++ generators in lanes that are advanced together, so the raw
+/// numbers are generated with vector instructions. A generator is seeded
+/// from a seed of the query and the id of a stream, e.g. the first tuple of
+/// a morsel. As long as the streams do not depend on the worker that
+/// processes them, results are the same for any number of threads. The
+/// class satisfies UniformRandomBitGenerator, so it can also be used with
+/// the distributions of <random>.
+class RandomGenerator {
+   public:
+   using result_type = uint64_t;
+
+   /// The number of lanes
+   static constexpr unsigned numLanes = 4;
+
+   private:
+   /// The states of the lanes, i.e. state[i][lane] is word i of a lane
+   alignas(32) uint64_t state[4][numLanes];
+   /// The numbers of the last step that were not returned yet
+   uint64_t buffer[numLanes];
+   /// The next number in buffer
+   unsigned bufferPosition = numLanes;
+
+   /// Rotate a value to the left
+   static constexpr uint64_t rotateLeft(uint64_t x, int k) {
+      return (x << k) | (x >> (64 - k));
+   }
+
+   /// Advance all lanes and store one number of each lane in output
+   void step(uint64_t* output) {
+      for (unsigned lane = 0; lane < numLanes; ++lane) {
+         auto s0 = state[0][lane], s1 = state[1][lane], s2 = state[2][lane], s3 = state[3][lane];
+         output[lane] = rotateLeft(s0 + s3, 23) + s0;
+         auto t = s1 << 17;
+         s2 ^= s0;
+         s3 ^= s1;
+         s1 ^= s2;
+         s0 ^= s3;
+         s2 ^= t;
+         s3 = rotateLeft(s3, 45);
+         state[0][lane] = s0;
+         state[1][lane] = s1;
+         state[2][lane] = s2;
+         state[3][lane] = s3;
+      }
+   }
+
+   /// Convert a random number to a double in [0, 1)
+   static double toDouble(uint64_t x) {
+      return static_cast<double>(x >> 11) * 0x1.0p-53;
+   }
+
+   public:
+   /// Mix the bits of a value, this is the finalizer of splitmix64
+   static constexpr uint64_t mix(uint64_t z) {
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      return z ^ (z >> 31);
+   }
+
+   /// Constructor. Different streams of the same seed are independent.
+   explicit RandomGenerator(uint64_t seed, uint64_t stream = 0) {
+      // Expand the seed and stream with splitmix64 as recommended for xoshiro
+      uint64_t splitMixState = mix(seed) ^ mix(stream + 0x9e3779b97f4a7c15ull);
+      for (auto& word : state)
+         for (auto& value : word)
+            value = mix(splitMixState += 0x9e3779b97f4a7c15ull);
+   }
+
+   /// The smallest number that is generated
+   static constexpr uint64_t min() { return 0; }
+   /// The largest number that is generated
+   static constexpr uint64_t max() { return std::numeric_limits<uint64_t>::max(); }
+
+   /// Get a random number
+   uint64_t operator()() {
+      if (bufferPosition == numLanes) [[unlikely]] {
+         step(buffer);
+         bufferPosition = 0;
+      }
+      return buffer[bufferPosition++];
+   }
+
+   /// Get a uniformly distributed double in [0, 1)
+   double nextDouble() {
+      return toDouble((*this)());
+   }
+
+   /// Get a uniformly distributed integer in [0, bound) for bound > 0
+   uint64_t nextBounded(uint64_t bound) {
+      // Lemire's multiply and shift with rejection of the biased part
+      auto product = static_cast<unsigned __int128>((*this)()) * bound;
+      if (static_cast<uint64_t>(product) < bound) [[unlikely]] {
+         auto threshold = -bound % bound;
+         while (static_cast<uint64_t>(product) < threshold)
+            product = static_cast<unsigned __int128>((*this)()) * bound;
+      }
+      return static_cast<uint64_t>(product >> 64);
+   }
+
+   /// Fill values with uniformly distributed doubles in [low, high)
+   void fillUniform(std::span<double> values, double low = 0.0, double high = 1.0) {
+      auto scale = high - low;
+      auto* output = values.data();
+      auto* end = output + values.size();
+      for (; static_cast<size_t>(end - output) >= numLanes; output += numLanes) {
+         uint64_t numbers[numLanes];
+         step(numbers);
+         for (unsigned lane = 0; lane < numLanes; ++lane)
+            output[lane] = low + scale * toDouble(numbers[lane]);
+      }
+      for (; output != end; ++output)
+         *output = low + scale * nextDouble();
+   }
+
+   /// Fill values with normally distributed doubles
+   void fillNormal(std::span<double> values, double mean = 0.0, double stddev = 1.0) {
+      // Marsaglia's polar method. Every step yields a candidate point in
+      // [-1, 1)^2 per lane, points inside the unit circle give two values.
+      auto* output = values.data();
+      auto* end = output + values.size();
+      while (output != end) {
+         uint64_t us[numLanes], vs[numLanes];
+         step(us);
+         step(vs);
+         for (unsigned lane = 0; lane < numLanes && output != end; ++lane) {
+            auto u = 2.0 * toDouble(us[lane]) - 1.0;
+            auto v = 2.0 * toDouble(vs[lane]) - 1.0;
+            auto s = u * u + v * v;
+            if (s >= 1.0 || s == 0.0)
+               continue;
+            auto factor = stddev * std::sqrt(-2.0 * std::log(s) / s);
+            *output++ = mean + factor * u;
+            if (output != end)
+               *output++ = mean + factor * v;
+         }
+      }
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,310 @@
+#ifndef H_udo_runtime_StringSearch
+#define H_udo_runtime_StringSearch
+//---------------------------------------------------------------------------
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// The implementations of the string search
+enum class SearchKernel {
+   /// One position after the other, for any CPU
+   Scalar,
+   /// 16 positions at once with SSE2
+   SSE2,
+   /// 32 positions at once with AVX2
+   AVX2,
+   /// 64 positions at once with AVX-512BW
+   AVX512,
+};
+//---------------------------------------------------------------------------
+/// Get the name of a search kernel
+inline const char* getSearchKernelName(SearchKernel kernel) {
+   switch (kernel) {
+      case SearchKernel::Scalar: return "scalar";
+      case SearchKernel::SSE2: return "sse2";
+      case SearchKernel::AVX2: return "avx2";
+      case SearchKernel::AVX512: return "avx512";
+   }
+   __builtin_unreachable();
+}
+//---------------------------------------------------------------------------
+/// Is a search kernel supported by the current CPU?
+inline bool isSearchKernelSupported(SearchKernel kernel) {
+#if defined(__x86_64__)
+   __builtin_cpu_init();
+   switch (kernel) {
+      case SearchKernel::Scalar: return true;
+      case SearchKernel::SSE2: return true;
+      case SearchKernel::AVX2: return __builtin_cpu_supports("avx2");
+      case SearchKernel::AVX512: return __builtin_cpu_supports("avx512bw");
+   }
+   return false;
+#else
+   return kernel == SearchKernel::Scalar;
+#endif
+}
+//---------------------------------------------------------------------------
+/// Get the fastest search kernel of the current CPU
+inline SearchKernel getBestSearchKernel() {
+   for (auto kernel : {SearchKernel::AVX512, SearchKernel::AVX2, SearchKernel::SSE2})
+      if (isSearchKernelSupported(kernel))
+         return kernel;
+   return SearchKernel::Scalar;
+}
+//---------------------------------------------------------------------------
+/// Copy a text of at most 64 bytes into a zero-padded block of 64 bytes, so
+/// that vector loads from the block do not read past the end of the text.
+/// The text is copied with overlapping loads of fixed size, which is much
+/// faster than memcpy() for the short texts of the search kernels.
+inline void copyToPaddedBlock(char (&block)[64], const char* text, size_t size) {
+   std::memset(block, 0, sizeof(block));
+   if (size >= 16) {
+      for (size_t i = 0; i + 16 <= size; i += 16)
+         std::memcpy(block + i, text + i, 16);
+      std::memcpy(block + size - 16, text + size - 16, 16);
+   } else if (size >= 8) {
+      std::memcpy(block, text, 8);
+      std::memcpy(block + size - 8, text + size - 8, 8);
+   } else if (size >= 4) {
+      std::memcpy(block, text, 4);
+      std::memcpy(block + size - 4, text + size - 4, 4);
+   } else if (size > 0) {
+      block[0] = text[0];
+      block[size / 2] = text[size / 2];
+      block[size - 1] = text[size - 1];
+   }
+}
+//---------------------------------------------------------------------------
+/// A pattern for case-insensitive comparisons. Only ASCII letters are
+/// folded, all other bytes must match exactly. A letter c matches a byte b
+/// exactly when (b | 0x20) == (c | 0x20), so folding costs a single OR.
+class FoldedPattern {
+   private:
+   /// The pattern with lower case letters, in words of 8 bytes padded with
+   /// zero bytes
+   std::vector<uint64_t> patternWords;
+   /// The bits that are set in every byte of the text before it is compared
+   /// to the pattern, 0x20 for letters and 0 otherwise, in words of 8 bytes
+   std::vector<uint64_t> foldWords;
+   /// The size of the pattern
+   size_t patternSize;
+
+   public:
+   /// Constructor
+   explicit FoldedPattern(std::string_view pattern) : patternWords((pattern.size() + 7) / 8), foldWords((pattern.size() + 7) / 8), patternSize(pattern.size()) {
+      for (size_t i = 0; i < pattern.size(); ++i) {
+         uint8_t c = pattern[i];
+         uint64_t fold = isLetter(c) ? 0x20 : 0;
+         patternWords[i / 8] |= static_cast<uint64_t>(c | fold) << (8 * (i % 8));
+         foldWords[i / 8] |= fold << (8 * (i % 8));
+      }
+   }
+
+   /// Is a byte an ASCII letter?
+   static bool isLetter(uint8_t c) {
+      return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+   }
+
+   /// Get the size of the pattern
+   size_t size() const { return patternSize; }
+   /// Get a byte of the pattern, letters are lower case
+   uint8_t getByte(size_t i) const { return patternWords[i / 8] >> (8 * (i % 8)); }
+   /// Get the fold bits of a byte of the pattern
+   uint8_t getFold(size_t i) const { return foldWords[i / 8] >> (8 * (i % 8)); }
+
+   /// Does the pattern occur at the given position? The text must contain at
+   /// least size() bytes there and end at textEnd.
+   bool matchesAt(const char* text, const char* textEnd) const {
+      size_t i = 0, word = 0;
+      for (; i + 8 <= patternSize; i += 8, ++word) {
+         uint64_t value;
+         std::memcpy(&value, text + i, 8);
+         if ((value | foldWords[word]) != patternWords[word])
+            return false;
+      }
+      if (i == patternSize)
+         return true;
+      // The last word is loaded as a whole and masked unless that would read
+      // past the end of the text
+      auto rest = patternSize - i;
+      uint64_t value = 0;
+      if (textEnd - (text + i) >= 8) {
+         std::memcpy(&value, text + i, 8);
+         value &= ~0ull >> (64 - 8 * rest);
+      } else {
+         std::memcpy(&value, text + i, rest);
+      }
+      return (value | foldWords[word]) == patternWords[word];
+   }
+};
+//---------------------------------------------------------------------------
+/// A case-insensitive substring search for a pattern that is fixed at
+/// construction, see FoldedPattern. The vectorized kernels compare the first
+/// and the last byte of the pattern at many positions of the text at once
+/// and only verify the positions where both match, so a search rarely
+/// branches. The kernel is selected for the CPU at runtime.
+class CaseInsensitiveSearch {
+   public:
+   /// The result of find() when the pattern does not occur
+   static constexpr size_t npos = std::string_view::npos;
+
+   private:
+   /// The pattern
+   FoldedPattern pattern;
+   /// The size of the pattern
+   size_t patternSize;
+   /// The first byte of the pattern and its fold bits
+   uint8_t first, firstFold;
+   /// The last byte of the pattern and its fold bits
+   uint8_t last, lastFold;
+   /// The kernel
+   SearchKernel kernel;
+
+   /// Search the positions in [begin, end) one after the other
+   size_t findScalar(const char* text, size_t begin, size_t end) const {
+      auto* textEnd = text + end + patternSize - 1;
+      for (size_t i = begin; i < end; ++i)
+         if ((static_cast<uint8_t>(text[i]) | firstFold) == first && (static_cast<uint8_t>(text[i + patternSize - 1]) | lastFold) == last && pattern.matchesAt(text + i, textEnd))
+            return i;
+      return npos;
+   }
+
+   /// Verify the candidate positions of a block. Returns the first match.
+   size_t verifyCandidates(const char* text, size_t numPositions, size_t begin, uint64_t candidates) const {
+      auto* textEnd = text + numPositions + patternSize - 1;
+      while (candidates) {
+         auto i = begin + __builtin_ctzll(candidates);
+         if (pattern.matchesAt(text + i, textEnd))
+            return i;
+         candidates &= candidates - 1;
+      }
+      return npos;
+   }
+
+#if defined(__x86_64__)
+   /// Get the positions of a block of 16 where the first and the last byte
+   /// of the pattern match
+   uint64_t matchBlockSSE2(const char* block) const {
+      auto firstBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+      auto lastBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + patternSize - 1));
+      auto firstMatches = _mm_cmpeq_epi8(_mm_or_si128(firstBytes, _mm_set1_epi8(firstFold)), _mm_set1_epi8(first));
+      auto lastMatches = _mm_cmpeq_epi8(_mm_or_si128(lastBytes, _mm_set1_epi8(lastFold)), _mm_set1_epi8(last));
+      return static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(firstMatches, lastMatches)));
+   }
+
+   /// Get the positions of a block of 32 where the first and the last byte
+   /// of the pattern match
+   __attribute__((target("avx2"), always_inline)) uint64_t matchBlockAVX2(const char* block) const {
+      auto firstBytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+      auto lastBytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + patternSize - 1));
+      auto firstMatches = _mm256_cmpeq_epi8(_mm256_or_si256(firstBytes, _mm256_set1_epi8(firstFold)), _mm256_set1_epi8(first));
+      auto lastMatches = _mm256_cmpeq_epi8(_mm256_or_si256(lastBytes, _mm256_set1_epi8(lastFold)), _mm256_set1_epi8(last));
+      return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(firstMatches, lastMatches)));
+   }
+
+   /// Search a text with fewer than 16 positions with SSE2. The text is
+   /// copied into a zero-padded block, so no byte after it is read.
+   size_t findShortSSE2(const char* text, size_t numPositions) const {
+      alignas(16) char block[64];
+      if (patternSize + 15 > sizeof(block))
+         return findScalar(text, 0, numPositions);
+      copyToPaddedBlock(block, text, numPositions + patternSize - 1);
+      uint64_t candidates = matchBlockSSE2(block) & ((1ull << numPositions) - 1);
+      return candidates ? verifyCandidates(block, numPositions, 0, candidates) : npos;
+   }
+
+   /// Search with SSE2. The last block is moved back to end with the text,
+   /// so no byte after the text is read.
+   size_t findSSE2(const char* text, size_t numPositions) const {
+      if (numPositions < 16)
+         return findShortSSE2(text, numPositions);
+      size_t i = 0;
+      for (; i + 16 <= numPositions; i += 16)
+         if (uint64_t candidates = matchBlockSSE2(text + i))
+            if (auto result = verifyCandidates(text, numPositions, i, candidates); result != npos)
+               return result;
+      if (i == numPositions)
+         return npos;
+      // The positions before i were searched already
+      auto begin = numPositions - 16;
+      uint64_t candidates = matchBlockSSE2(text + begin) & (~0ull << (i - begin));
+      return candidates ? verifyCandidates(text, numPositions, begin, candidates) : npos;
+   }
+
+   /// Search with AVX2, like findSSE2()
+   __attribute__((target("avx2"))) size_t findAVX2(const char* text, size_t numPositions) const {
+      if (numPositions < 32)
+         return findSSE2(text, numPositions);
+      size_t i = 0;
+      for (; i + 32 <= numPositions; i += 32)
+         if (uint64_t candidates = matchBlockAVX2(text + i))
+            if (auto result = verifyCandidates(text, numPositions, i, candidates); result != npos)
+               return result;
+      if (i == numPositions)
+         return npos;
+      // The positions before i were searched already
+      auto begin = numPositions - 32;
+      uint64_t candidates = matchBlockAVX2(text + begin) & (~0ull << (i - begin));
+      return candidates ? verifyCandidates(text, numPositions, begin, candidates) : npos;
+   }
+
+   /// Search with AVX-512BW. Masked loads do not fault on the masked bytes,
+   /// so the end of the text needs no special case.
+   __attribute__((target("avx512f,avx512bw"))) size_t findAVX512(const char* text, size_t numPositions) const {
+      auto firstVec = _mm512_set1_epi8(first), firstFoldVec = _mm512_set1_epi8(firstFold);
+      auto lastVec = _mm512_set1_epi8(last), lastFoldVec = _mm512_set1_epi8(lastFold);
+      for (size_t i = 0; i < numPositions; i += 64) {
+         __mmask64 valid = numPositions - i >= 64 ? ~0ull : (1ull << (numPositions - i)) - 1;
+         auto firstBytes = _mm512_maskz_loadu_epi8(valid, text + i);
+         auto lastBytes = _mm512_maskz_loadu_epi8(valid, text + i + patternSize - 1);
+         auto firstMatches = _mm512_mask_cmpeq_epi8_mask(valid, _mm512_or_si512(firstBytes, firstFoldVec), firstVec);
+         uint64_t candidates = _mm512_mask_cmpeq_epi8_mask(firstMatches, _mm512_or_si512(lastBytes, lastFoldVec), lastVec);
+         if (candidates)
+            if (auto result = verifyCandidates(text, numPositions, i, candidates); result != npos)
+               return result;
+      }
+      return npos;
+   }
+#endif
+
+   public:
+   /// Constructor. The pattern must not be empty.
+   explicit CaseInsensitiveSearch(std::string_view pattern, SearchKernel kernel = getBestSearchKernel())
+      : pattern(pattern), patternSize(pattern.size()), first(this->pattern.getByte(0)), firstFold(this->pattern.getFold(0)),
+        last(this->pattern.getByte(patternSize - 1)), lastFold(this->pattern.getFold(patternSize - 1)), kernel(kernel) {}
+
+   /// Get the kernel
+   SearchKernel getKernel() const { return kernel; }
+
+   /// Find the first occurrence of the pattern in a text
+   size_t find(std::string_view text) const {
+      if (text.size() < patternSize)
+         return npos;
+      auto numPositions = text.size() - patternSize + 1;
+      switch (kernel) {
+#if defined(__x86_64__)
+         case SearchKernel::AVX512: return findAVX512(text.data(), numPositions);
+         case SearchKernel::AVX2: return findAVX2(text.data(), numPositions);
+         case SearchKernel::SSE2: return findSSE2(text.data(), numPositions);
+#endif
+         default: return findScalar(text.data(), 0, numPositions);
+      }
+   }
+
+   /// Does the pattern occur in a text?
+   bool contains(std::string_view text) const {
+      return find(text) != npos;
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,217 @@
+#ifndef H_udo_runtime_Topology
+#define H_udo_runtime_Topology
+//---------------------------------------------------------------------------
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include <dirent.h>
+#include <sched.h>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// A logical CPU on which the process is allowed to run
+struct CpuInfo {
+   /// The id of the logical CPU
+   unsigned cpu;
+   /// The NUMA node of the CPU
+   unsigned node;
+   /// The socket of the CPU
+   unsigned package;
+   /// The physical core of the CPU within its socket
+   unsigned core;
+};
+//---------------------------------------------------------------------------
+/// The policies to place workers on CPUs
+enum class Placement {
+   /// Fill one NUMA node after the other, with the SMT siblings of a core
+   /// next to each other
+   Compact,
+   /// Distribute the workers round-robin across the sockets, using the
+   /// physical cores of a socket before their SMT siblings
+   Scatter,
+   /// Use one CPU of every physical core before any SMT sibling, filling one
+   /// NUMA node after the other
+   PhysicalCoresFirst,
+};
+//---------------------------------------------------------------------------
+/// Get the name of a placement policy
+inline const char* getPlacementName(Placement placement) {
+   switch (placement) {
+      case Placement::Compact: return "compact";
+      case Placement::Scatter: return "scatter";
+      case Placement::PhysicalCoresFirst: return "cores";
+   }
+   __builtin_unreachable();
+}
+//---------------------------------------------------------------------------
+/// Parse the name of a placement policy
+inline std::optional<Placement> parsePlacement(std::string_view name) {
+   for (auto placement : {Placement::Compact, Placement::Scatter, Placement::PhysicalCoresFirst})
+      if (name == getPlacementName(placement))
+         return placement;
+   return std::nullopt;
+}
+//---------------------------------------------------------------------------
+/// Pin the calling thread to a CPU. Pinning is best effort, e.g. the
+/// affinity mask may have changed, so failures are ignored.
+inline void pinCurrentThread(unsigned cpu) {
+   ::cpu_set_t cpuSet;
+   CPU_ZERO(&cpuSet);
+   CPU_SET(cpu, &cpuSet);
+   ::sched_setaffinity(0, sizeof(cpuSet), &cpuSet);
+}
+//---------------------------------------------------------------------------
+/// Print the CPU of every worker
+inline void printPlacement(std::ostream& out, Placement placement, std::span<const CpuInfo> workerCpus) {
+   out << "placement: " << getPlacementName(placement) << '\n';
+   out << "worker,cpu,node,package,core\n";
+   for (size_t i = 0; i < workerCpus.size(); ++i) {
+      auto& info = workerCpus[i];
+      out << i << ',' << info.cpu << ',' << info.node << ',' << info.package << ',' << info.core << '\n';
+   }
+}
+//---------------------------------------------------------------------------
+/// The CPU topology as seen by the current process
+class Topology {
+   private:
+   /// All CPUs in the affinity mask, ordered by node and CPU id
+   std::vector<CpuInfo> cpus;
+   /// The number of distinct NUMA nodes
+   unsigned numNodes = 1;
+
+   /// Read a single number from a sysfs file
+   static bool readNumber(const std::string& path, unsigned& value) {
+      std::ifstream file(path);
+      return static_cast<bool>(file >> value);
+   }
+
+   /// Determine the NUMA node of a CPU from its sysfs directory
+   static unsigned readNode(unsigned cpu) {
+      auto path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+      auto* dir = ::opendir(path.c_str());
+      if (!dir)
+         return 0;
+      unsigned node = 0;
+      while (auto* entry = ::readdir(dir)) {
+         std::string_view name(entry->d_name);
+         if (name.starts_with("node") && name.size() > 4 && name[4] >= '0' && name[4] <= '9') {
+            node = std::stoul(std::string(name.substr(4)));
+            break;
+         }
+      }
+      ::closedir(dir);
+      return node;
+   }
+
+   public:
+   /// Detect the topology of all CPUs in the affinity mask of this process
+   static Topology detect() {
+      Topology topology;
+
+      ::cpu_set_t cpuSet = {};
+      if (::sched_getaffinity(0, sizeof(cpuSet), &cpuSet) != 0)
+         CPU_ZERO(&cpuSet);
+
+      for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+         if (!CPU_ISSET(cpu, &cpuSet))
+            continue;
+
+         CpuInfo info{cpu, readNode(cpu), 0, cpu};
+         auto topologyPath = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+         readNumber(topologyPath + "physical_package_id", info.package);
+         readNumber(topologyPath + "core_id", info.core);
+         topology.cpus.push_back(info);
+      }
+
+      // Without any information we pretend to have a single CPU
+      if (topology.cpus.empty())
+         topology.cpus.push_back({0, 0, 0, 0});
+
+      std::sort(topology.cpus.begin(), topology.cpus.end(), [](const CpuInfo& a, const CpuInfo& b) {
+         return a.node != b.node ? a.node < b.node : a.cpu < b.cpu;
+      });
+
+      // Renumber the nodes densely so that they can be used as indexes
+      unsigned denseNode = 0;
+      unsigned lastNode = topology.cpus.front().node;
+      for (auto& info : topology.cpus) {
+         if (info.node != lastNode) {
+            lastNode = info.node;
+            ++denseNode;
+         }
+         info.node = denseNode;
+      }
+      topology.numNodes = denseNode + 1;
+
+      return topology;
+   }
+
+   /// Get all CPUs
+   std::span<const CpuInfo> getCpus() const { return cpus; }
+   /// Get the number of NUMA nodes
+   unsigned getNumNodes() const { return numNodes; }
+
+   /// Get the CPU for every worker according to a placement policy. When
+   /// there are more workers than CPUs, the order starts over.
+   std::vector<CpuInfo> getWorkerCpus(size_t numWorkers, Placement placement) const {
+      // Order the CPUs by node and physical core, so that SMT siblings are
+      // next to each other
+      auto order = cpus;
+      std::sort(order.begin(), order.end(), [](const CpuInfo& a, const CpuInfo& b) {
+         return std::tie(a.node, a.package, a.core, a.cpu) < std::tie(b.node, b.package, b.core, b.cpu);
+      });
+
+      if (placement != Placement::Compact) {
+         // Number the SMT siblings of every core, so that the i-th siblings
+         // of all cores come before the (i+1)-th siblings
+         std::vector<unsigned> siblingIndex(order.size());
+         for (size_t i = 1; i < order.size(); ++i) {
+            bool sameCore = order[i].package == order[i - 1].package && order[i].core == order[i - 1].core;
+            siblingIndex[i] = sameCore ? siblingIndex[i - 1] + 1 : 0;
+         }
+         std::vector<std::tuple<unsigned, unsigned, size_t>> keys;
+         for (size_t i = 0; i < order.size(); ++i) {
+            if (placement == Placement::Scatter) {
+               // Within each socket, take the physical cores first, then
+               // interleave the sockets
+               unsigned rank = 0;
+               for (size_t j = 0; j < order.size(); ++j)
+                  if (order[j].package == order[i].package && std::tie(siblingIndex[j], j) < std::tie(siblingIndex[i], i))
+                     ++rank;
+               keys.emplace_back(rank, order[i].package, i);
+            } else {
+               keys.emplace_back(siblingIndex[i], order[i].node, i);
+            }
+         }
+         std::sort(keys.begin(), keys.end());
+         std::vector<CpuInfo> placed;
+         for (auto& key : keys)
+            placed.push_back(order[std::get<2>(key)]);
+         order = std::move(placed);
+      }
+
+      std::vector<CpuInfo> workerCpus(numWorkers);
+      for (size_t i = 0; i < numWorkers; ++i)
+         workerCpus[i] = order[i % order.size()];
+      return workerCpus;
+   }
+
+   /// Get the NUMA node for every worker according to a placement policy
+   std::vector<unsigned> getWorkerNodes(size_t numWorkers, Placement placement = Placement::Compact) const {
+      std::vector<unsigned> workerNodes;
+      for (auto& info : getWorkerCpus(numWorkers, placement))
+         workerNodes.push_back(info.node);
+      return workerNodes;
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,231 @@
+#ifndef H_udo_runtime_Trace
+#define H_udo_runtime_Trace
+//---------------------------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// Is tracing compiled in? Define UDO_TRACE to enable it. Otherwise, all
+/// trace points are removed by the compiler.
+#ifdef UDO_TRACE
+constexpr bool traceEnabled = true;
+#else
+constexpr bool traceEnabled = false;
+#endif
+//---------------------------------------------------------------------------
+/// The kinds of spans that are traced
+enum class TraceEvent : uint8_t {
+   /// A worker is in the input state. The argument is unused.
+   Input,
+   /// A worker consumes a morsel. The argument is the number of tuples.
+   Morsel,
+   /// A worker runs a step of extraWork(). The argument is the step id.
+   ExtraWork,
+   /// A worker runs a serial step of extraWork(). The argument is the step id.
+   SerialStep,
+   /// A worker generates the output. The argument is unused.
+   Output,
+   /// A worker waits at the barrier. The argument is the execution state
+   /// (in the upper 32 bits) and step id the worker waits for.
+   BarrierWait,
+};
+//---------------------------------------------------------------------------
+/// A span recorded by a worker
+struct TraceSpan {
+   /// The begin timestamp in nanoseconds since the start of the trace
+   uint64_t begin;
+   /// The end timestamp in nanoseconds since the start of the trace
+   uint64_t end;
+   /// The argument
+   uint64_t arg;
+   /// The kind of the span
+   TraceEvent event;
+};
+//---------------------------------------------------------------------------
+/// The spans recorded during one run of the standalone runtime. Every worker
+/// appends to its own buffer, so recording needs no synchronization.
+class Trace {
+   public:
+   /// The function that returns the name of an extraWork() step, if any
+   using StepNameFunction = const char* (*) (uint32_t stepId);
+
+   private:
+   /// The spans of a worker
+   struct alignas(64) WorkerSpans {
+      /// The spans
+      std::vector<TraceSpan> spans;
+   };
+
+   /// The spans of every worker
+   std::vector<WorkerSpans> workers;
+   /// The start of the trace
+   std::chrono::steady_clock::time_point start;
+   /// The function that names the steps
+   StepNameFunction stepName = nullptr;
+
+   /// Get the name of a span
+   std::string getName(const TraceSpan& span) const {
+      switch (span.event) {
+         case TraceEvent::Input: return "Input";
+         case TraceEvent::Morsel: return "Morsel";
+         case TraceEvent::ExtraWork:
+         case TraceEvent::SerialStep: return getStepName(span.arg);
+         case TraceEvent::Output: return "Output";
+         case TraceEvent::BarrierWait: return "Barrier";
+      }
+      __builtin_unreachable();
+   }
+   /// Get the name of a step
+   std::string getStepName(uint64_t stepId) const {
+      if (stepName)
+         if (auto* name = stepName(stepId))
+            return name;
+      return "Step " + std::to_string(stepId);
+   }
+   /// Get the category of a span
+   static const char* getCategory(TraceEvent event) {
+      switch (event) {
+         case TraceEvent::Input:
+         case TraceEvent::Morsel: return "input";
+         case TraceEvent::ExtraWork: return "extraWork";
+         case TraceEvent::SerialStep: return "serial";
+         case TraceEvent::Output: return "output";
+         case TraceEvent::BarrierWait: return "barrier";
+      }
+      __builtin_unreachable();
+   }
+
+   public:
+   /// Start a new trace for the given number of workers
+   void begin(size_t numWorkers, StepNameFunction stepName = nullptr) {
+      workers.clear();
+      workers.resize(numWorkers);
+      start = std::chrono::steady_clock::now();
+      this->stepName = stepName;
+   }
+
+   /// Get the current timestamp
+   uint64_t now() const {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+   }
+
+   /// Record a span of a worker
+   void record(size_t workerId, TraceEvent event, uint64_t arg, uint64_t begin, uint64_t end) {
+      workers[workerId].spans.push_back({begin, end, arg, event});
+   }
+
+   /// Write the trace in the Chrome trace event format that can be loaded
+   /// into chrome://tracing or Perfetto
+   void writeChromeTrace(std::ostream& out) const {
+      out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+      bool first = true;
+      auto separator = [&]() -> std::ostream& {
+         if (!first)
+            out << ",\n";
+         first = false;
+         return out;
+      };
+      for (size_t workerId = 0; workerId < workers.size(); ++workerId) {
+         separator() << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << workerId << R"(,"args":{"name":"Worker )" << workerId << "\"}}";
+         for (auto& span : workers[workerId].spans) {
+            separator() << "{\"name\":\"" << getName(span) << "\",\"cat\":\"" << getCategory(span.event) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << workerId;
+            out << std::fixed << std::setprecision(3) << ",\"ts\":" << span.begin / 1000.0 << ",\"dur\":" << (span.end - span.begin) / 1000.0;
+            out << std::defaultfloat << ",\"args\":{\"arg\":" << span.arg << "}}";
+         }
+      }
+      out << "]}\n";
+   }
+
+   /// Print the time spent in every kind of span summed over all workers.
+   /// Morsels are contained in the input spans and serial steps in the
+   /// barrier spans, so they are listed separately.
+   void printSummary(std::ostream& out) const {
+      struct Entry {
+         uint64_t count = 0;
+         uint64_t total = 0;
+         uint64_t max = 0;
+      };
+      std::map<std::tuple<TraceEvent, std::string>, Entry> entries;
+      uint64_t end = 0;
+      for (auto& worker : workers)
+         for (auto& span : worker.spans) {
+            auto duration = span.end - span.begin;
+            auto& entry = entries[{span.event, getName(span)}];
+            ++entry.count;
+            entry.total += duration;
+            entry.max = std::max(entry.max, duration);
+            end = std::max(end, span.end);
+         }
+
+      uint64_t workerTime = end * workers.size();
+      out << std::left << std::setw(10) << "category" << std::setw(28) << "name" << std::right << std::setw(10) << "count" << std::setw(14) << "total_ms" << std::setw(12) << "mean_us" << std::setw(12) << "max_us" << std::setw(10) << "share" << '\n';
+      for (auto& [key, entry] : entries) {
+         auto& [event, name] = key;
+         out << std::left << std::setw(10) << getCategory(event) << std::setw(28) << name << std::right << std::setw(10) << entry.count;
+         out << std::fixed << std::setprecision(3) << std::setw(14) << entry.total / 1e6 << std::setw(12) << entry.total / 1e3 / entry.count << std::setw(12) << entry.max / 1e3;
+         out << std::setprecision(1) << std::setw(9) << (workerTime ? 100.0 * entry.total / workerTime : 0.0) << '%' << std::defaultfloat << '\n';
+      }
+      // The morsel sizes that were chosen by the scheduler
+      uint64_t numMorsels = 0;
+      uint64_t numTuples = 0;
+      uint64_t minMorsel = ~0ull;
+      uint64_t maxMorsel = 0;
+      for (auto& worker : workers)
+         for (auto& span : worker.spans)
+            if (span.event == TraceEvent::Morsel) {
+               ++numMorsels;
+               numTuples += span.arg;
+               minMorsel = std::min(minMorsel, span.arg);
+               maxMorsel = std::max(maxMorsel, span.arg);
+            }
+      if (numMorsels > 0)
+         out << "morsel sizes: min " << minMorsel << ", mean " << numTuples / numMorsels << ", max " << maxMorsel << '\n';
+      out << "wall time: " << std::fixed << std::setprecision(3) << end / 1e6 << " ms, workers: " << workers.size() << std::defaultfloat << '\n';
+   }
+};
+//---------------------------------------------------------------------------
+/// Records a span from its construction until its destruction. Does nothing
+/// when tracing is not compiled in.
+class TraceScope {
+   private:
+   /// The trace
+   Trace& trace;
+   /// The worker
+   size_t workerId;
+   /// The kind of the span
+   TraceEvent event;
+   /// The argument
+   uint64_t arg;
+   /// The begin timestamp
+   uint64_t begin = 0;
+
+   public:
+   /// Constructor
+   TraceScope(Trace& trace, size_t workerId, TraceEvent event, uint64_t arg = 0) : trace(trace), workerId(workerId), event(event), arg(arg) {
+      if constexpr (traceEnabled)
+         begin = trace.now();
+   }
+   /// Destructor
+   ~TraceScope() {
+      if constexpr (traceEnabled)
+         trace.record(workerId, event, arg, begin, trace.now());
+   }
+
+   TraceScope(const TraceScope&) = delete;
+   TraceScope& operator=(const TraceScope&) = delete;
+
+   /// Set the argument of the span
+   void setArg(uint64_t newArg) { arg = newArg; }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
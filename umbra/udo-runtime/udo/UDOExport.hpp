@@ -0,0 +1,197 @@
+#ifndef H_udo_runtime_UDOExport
+#define H_udo_runtime_UDOExport
+//---------------------------------------------------------------------------
+#include "udo/Columns.hpp"
+#include "udo/UDOStandalone.hpp"
+#include "udo/UDOperator.hpp"
+#include "udo/WorkerPool.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// The version of the exported interface below. It is incremented whenever
+/// the layout of the structs changes.
+constexpr uint32_t exportVersion = 1;
+//---------------------------------------------------------------------------
+/// The types of the attributes of exported tuples
+enum class AttributeType : uint32_t {
+   Bool,
+   Int8,
+   Int16,
+   Int32,
+   Int64,
+   UInt8,
+   UInt16,
+   UInt32,
+   UInt64,
+   Float,
+   Double,
+   String,
+};
+//---------------------------------------------------------------------------
+/// Get the name of an attribute type
+inline const char* getAttributeTypeName(AttributeType type) {
+   switch (type) {
+      case AttributeType::Bool: return "bool";
+      case AttributeType::Int8: return "int8";
+      case AttributeType::Int16: return "int16";
+      case AttributeType::Int32: return "int32";
+      case AttributeType::Int64: return "int64";
+      case AttributeType::UInt8: return "uint8";
+      case AttributeType::UInt16: return "uint16";
+      case AttributeType::UInt32: return "uint32";
+      case AttributeType::UInt64: return "uint64";
+      case AttributeType::Float: return "float";
+      case AttributeType::Double: return "double";
+      case AttributeType::String: return "string";
+   }
+   __builtin_unreachable();
+}
+//---------------------------------------------------------------------------
+/// Get the attribute type of a C++ type
+template <typename T>
+constexpr AttributeType getAttributeType() {
+   if constexpr (std::is_same_v<T, bool>)
+      return AttributeType::Bool;
+   else if constexpr (std::is_same_v<T, String>)
+      return AttributeType::String;
+   else if constexpr (std::is_same_v<T, float>)
+      return AttributeType::Float;
+   else if constexpr (std::is_same_v<T, double>)
+      return AttributeType::Double;
+   else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+      return sizeof(T) == 1 ? AttributeType::Int8 : sizeof(T) == 2 ? AttributeType::Int16 : sizeof(T) == 4 ? AttributeType::Int32 : AttributeType::Int64;
+   else if constexpr (std::is_integral_v<T>)
+      return sizeof(T) == 1 ? AttributeType::UInt8 : sizeof(T) == 2 ? AttributeType::UInt16 : sizeof(T) == 4 ? AttributeType::UInt32 : AttributeType::UInt64;
+   else
+      static_assert(!sizeof(T), "unsupported attribute type");
+}
+//---------------------------------------------------------------------------
+/// An attribute of an exported tuple
+struct ExportedAttribute {
+   /// The type
+   AttributeType type;
+   /// The offset within the tuple
+   uint32_t offset;
+};
+//---------------------------------------------------------------------------
+/// The layout of an exported tuple type
+struct ExportedTupleLayout {
+   /// The size of a tuple including padding
+   uint32_t size;
+   /// The alignment of a tuple
+   uint32_t alignment;
+   /// The number of attributes
+   uint32_t numAttributes;
+   /// The attributes in the order of their columns
+   const ExportedAttribute* attributes;
+
+   /// Get the attributes
+   std::span<const ExportedAttribute> getAttributes() const { return {attributes, numAttributes}; }
+};
+//---------------------------------------------------------------------------
+/// The function that receives a chunk of output tuples of an exported UDO
+using ExportedOutputFunction = void (*)(void* context, const void* tuples, uint64_t numTuples);
+//---------------------------------------------------------------------------
+/// The interface of a UDO that was compiled into a shared object with
+/// UDO_STANDALONE_EXPORT(). It is returned by the function
+/// udoStandaloneExport() of the shared object.
+struct ExportedUDO {
+   /// The version of the interface, must be exportVersion
+   uint32_t version;
+   /// The name of the UDO class
+   const char* name;
+   /// The layout of the input tuples
+   ExportedTupleLayout input;
+   /// The layout of the output tuples
+   ExportedTupleLayout output;
+   /// Create a worker pool with the given number of threads and placement
+   void* (*createPool)(uint64_t numThreads, Placement placement);
+   /// Destroy a worker pool
+   void (*destroyPool)(void* pool);
+   /// Run a new instance of the UDO on the workers of a pool with the given
+   /// input tuples and morsel size. Passes the output to outputFunction in
+   /// chunks and returns the number of output tuples.
+   uint64_t (*run)(void* pool, uint64_t morselSize, const void* input, uint64_t numTuples, ExportedOutputFunction outputFunction, void* outputContext);
+};
+//---------------------------------------------------------------------------
+/// The name of the function that returns the ExportedUDO of a shared object
+constexpr const char* exportFunctionName = "udoStandaloneExport";
+//---------------------------------------------------------------------------
+/// The implementation of the exported interface for a UDO class
+template <typename UDO>
+class UDOExporter {
+   private:
+   using InputColumns = typename UDO::InputColumns;
+   using OutputColumns = typename UDO::OutputColumns;
+
+   static_assert(std::is_same_v<typename InputColumns::Tuple, typename UDO::InputTuple>, "the input columns must describe the input tuple");
+   static_assert(std::is_same_v<typename OutputColumns::Tuple, typename UDO::OutputTuple>, "the output columns must describe the output tuple");
+   static_assert(std::is_default_constructible_v<UDO>, "exported UDOs must be default constructible");
+
+   /// Get the attributes of the columns of a tuple type
+   template <typename C>
+   static const ExportedAttribute* getAttributes() {
+      static const auto attributes = [] {
+         std::array<ExportedAttribute, C::numColumns> attributes;
+         typename C::Tuple tuple{};
+         C::forEachColumn([&](auto i) {
+            auto offset = reinterpret_cast<const std::byte*>(&(tuple.*(C::template member<i>))) - reinterpret_cast<const std::byte*>(&tuple);
+            attributes[i] = {getAttributeType<typename C::template Type<i>>(), static_cast<uint32_t>(offset)};
+         });
+         return attributes;
+      }();
+      return attributes.data();
+   }
+
+   /// Get the layout of the columns of a tuple type
+   template <typename C>
+   static ExportedTupleLayout getLayout() {
+      return {sizeof(typename C::Tuple), alignof(typename C::Tuple), C::numColumns, getAttributes<C>()};
+   }
+
+   /// Create a worker pool
+   static void* createPool(uint64_t numThreads, Placement placement) {
+      return new WorkerPool(numThreads, placement);
+   }
+
+   /// Destroy a worker pool
+   static void destroyPool(void* pool) {
+      delete static_cast<WorkerPool*>(pool);
+   }
+
+   /// Run a new instance of the UDO
+   static uint64_t run(void* pool, uint64_t morselSize, const void* input, uint64_t numTuples, ExportedOutputFunction outputFunction, void* outputContext) {
+      UDO udo;
+      UDOStandalone<UDO> standalone(*static_cast<WorkerPool*>(pool), morselSize);
+      auto numOutput = standalone.run(udo, {static_cast<const typename UDO::InputTuple*>(input), numTuples});
+      for (auto chunk : standalone.getOutputChunks())
+         outputFunction(outputContext, chunk.data(), chunk.size());
+      return numOutput;
+   }
+
+   public:
+   /// Get the exported interface
+   static const ExportedUDO* get(const char* name) {
+      static const ExportedUDO exported{exportVersion, name, getLayout<InputColumns>(), getLayout<OutputColumns>(), &createPool, &destroyPool, &run};
+      return &exported;
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+/// Export a UDO from a shared object for the generic standalone driver. The
+/// UDO must be default constructible and describe the attributes of its
+/// tuples with udo::Columns types named InputColumns and OutputColumns.
+/// Only the listed attributes are read from the input and written to the
+/// output by the driver.
+#define UDO_STANDALONE_EXPORT(UDO) \
+   extern "C" __attribute__((visibility("default"))) const udo::ExportedUDO* udoStandaloneExport() { \
+      return udo::UDOExporter<UDO>::get(#UDO); \
+   }
+//---------------------------------------------------------------------------
+#endif
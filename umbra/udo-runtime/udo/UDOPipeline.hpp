@@ -0,0 +1,236 @@
+#ifndef H_udo_runtime_UDOPipeline
+#define H_udo_runtime_UDOPipeline
+//---------------------------------------------------------------------------
+#include "udo/UDOStandalone.hpp"
+#include "udo/UDOperator.hpp"
+#include "udo/WorkerStates.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <type_traits>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// The default conversion of a pipeline that passes the output tuples of the
+/// producer unchanged to the consumer
+struct PipelineIdentity {
+   template <typename T>
+   const T& operator()(const T& tuple) const { return tuple; }
+};
+//---------------------------------------------------------------------------
+/// Two UDOs that are fused into a single UDO for the standalone runtime. The
+/// tuples the producer generates are passed to consume() of the consumer by
+/// the worker that produced them, so the intermediate result is never
+/// materialized. The output of the pipeline is the output of the consumer.
+///
+/// The pipeline runs the phases of both UDOs one after the other:
+///  1. The input is consumed by the producer.
+///  2. The steps of extraWork() of the producer.
+///  3. postProduce() of the producer, whose tuples are consumed by the
+///     consumer.
+///  4. The steps of extraWork() of the consumer.
+///  5. postProduce() of the consumer.
+/// Tuples the producer generates before phase 3 are consumed as well. The
+/// step ids of both UDOs must be less than 2^30.
+///
+/// Every worker has its own local states for both UDOs, which are reset
+/// whenever the runtime resets the local state of the pipeline. Pipelines
+/// can be nested by using a pipeline as the producer or the consumer.
+///
+/// UDOs are written as separate translation units that may use the same
+/// global names. To combine them in one program, their .cpp files are
+/// included into a namespace each, e.g. `namespace kmeans { #include
+/// "udo_kmeans.cpp" }`. This requires two things from the program:
+///  - Every header that the UDOs use must be included before the
+///    namespaces, so that the include guards keep the headers out of them.
+///    A header that is missed may still compile when it is included
+///    indirectly, so the list must be kept in sync with the UDOs by hand.
+///  - UDO_NO_MAIN must be defined, so that the main() of the standalone
+///    program of a UDO and its helpers are left out.
+template <typename Producer, typename Consumer, typename Convert = PipelineIdentity>
+class UDOPipeline : public UDOperator<typename Producer::InputTuple, typename Consumer::OutputTuple> {
+   private:
+   using Base = UDOperator<typename Producer::InputTuple, typename Consumer::OutputTuple>;
+   using ProducerOutput = typename Producer::OutputTuple;
+   using Sink = typename UDOStandaloneBase<ProducerOutput>::OutputSink;
+
+   public:
+   using typename Base::LocalState;
+   using Base::extraWorkDone;
+
+   private:
+   /// The phases of extraWork(), stored in the upper bits of the step id
+   enum Phase : uint32_t {
+      ProducerExtraWork = 0u << 30,
+      ProducerPostProduce = 1u << 30,
+      ConsumerExtraWork = 2u << 30,
+   };
+   /// The mask for the step id of a UDO within a phase
+   static constexpr uint32_t stepMask = (1u << 30) - 1;
+
+   /// The local states of both UDOs for a worker
+   struct LocalStates {
+      /// The local state of the producer
+      typename Producer::LocalState producer;
+      /// The local state of the consumer
+      typename Consumer::LocalState consumer;
+   };
+
+   /// The context of the sink while the producer runs on a worker
+   struct SinkContext {
+      /// The pipeline
+      UDOPipeline& pipeline;
+      /// The local state of the consumer on the worker
+      typename Consumer::LocalState& localState;
+   };
+
+   /// Redirects the output of the producer into the consumer while it
+   /// exists
+   class SinkScope {
+      private:
+      /// The context of the sink
+      SinkContext context;
+      /// The previous sink
+      Sink previous;
+
+      public:
+      /// Constructor
+      SinkScope(UDOPipeline& pipeline, LocalStates& localStates) : context{pipeline, localStates.consumer} {
+         previous = UDOStandaloneBase<ProducerOutput>::exchangeOutputSink({&consumeOutput, &context});
+      }
+      /// Destructor
+      ~SinkScope() {
+         UDOStandaloneBase<ProducerOutput>::exchangeOutputSink(previous);
+      }
+
+      SinkScope(const SinkScope&) = delete;
+      SinkScope& operator=(const SinkScope&) = delete;
+   };
+
+   /// The producer
+   Producer& producer;
+   /// The consumer
+   Consumer& consumer;
+   /// The conversion from the output of the producer to the input of the
+   /// consumer
+   [[no_unique_address]] Convert convert;
+   /// The local states of every worker
+   WorkerStates<LocalStates> workerStates;
+
+   /// Can the output of the producer be passed to consumeBatch() of the
+   /// consumer as is?
+   static constexpr bool hasConsumeBatch = std::is_same_v<Convert, PipelineIdentity> && requires(Consumer& consumer, typename Consumer::LocalState& localState, std::span<const ProducerOutput> tuples) {
+      consumer.consumeBatch(localState, tuples);
+   };
+
+   /// Pass tuples of the producer to the consumer
+   static void consumeOutput(void* rawContext, std::span<const ProducerOutput> outputs) {
+      auto& context = *static_cast<SinkContext*>(rawContext);
+      auto& pipeline = context.pipeline;
+      // The consumer produces tuples of the same type for the real output
+      [[maybe_unused]] Sink sink;
+      if constexpr (std::is_same_v<ProducerOutput, typename Consumer::OutputTuple>)
+         sink = UDOStandaloneBase<ProducerOutput>::exchangeOutputSink({});
+
+      if constexpr (hasConsumeBatch) {
+         pipeline.consumer.consumeBatch(context.localState, outputs);
+      } else {
+         for (auto& output : outputs)
+            pipeline.consumer.consume(context.localState, pipeline.convert(output));
+      }
+
+      if constexpr (std::is_same_v<ProducerOutput, typename Consumer::OutputTuple>)
+         UDOStandaloneBase<ProducerOutput>::exchangeOutputSink(sink);
+   }
+
+   /// Get the local states of the current worker. They are reset when the
+   /// local state of the pipeline was reset.
+   LocalStates& getLocalStates(LocalState& localState) {
+      bool reset = !*reinterpret_cast<void**>(localState.data);
+      auto& localStates = workerStates.get(localState);
+      if (reset)
+         localStates = LocalStates();
+      return localStates;
+   }
+
+   /// Check that a step id of a UDO fits into a phase
+   static uint32_t checkStepId(uint32_t stepId) {
+      if (stepId > stepMask) {
+         printDebug("step id is too large for a pipeline\n");
+         std::abort();
+      }
+      return stepId;
+   }
+
+   public:
+   /// Constructor
+   UDOPipeline(Producer& producer, Consumer& consumer, Convert convert = {}) : producer(producer), consumer(consumer), convert(convert) {}
+
+   UDOPipeline(const UDOPipeline&) = delete;
+   UDOPipeline& operator=(const UDOPipeline&) = delete;
+
+   /// Accept an incoming tuple
+   void consume(LocalState& localState, const typename Producer::InputTuple& input) {
+      auto& localStates = getLocalStates(localState);
+      SinkScope sinkScope(*this, localStates);
+      producer.consume(localStates.producer, input);
+   }
+
+   /// Do the extra work of both UDOs and generate the output of the producer
+   uint32_t extraWork(LocalState& localState, uint32_t stepId) {
+      auto& localStates = getLocalStates(localState);
+      auto innerStepId = stepId & stepMask;
+      switch (static_cast<Phase>(stepId & ~stepMask)) {
+         case ProducerExtraWork: {
+            SinkScope sinkScope(*this, localStates);
+            auto nextStepId = producer.extraWork(localStates.producer, innerStepId);
+            return nextStepId == Producer::extraWorkDone ? ProducerPostProduce : ProducerExtraWork | checkStepId(nextStepId);
+         }
+         case ProducerPostProduce: {
+            SinkScope sinkScope(*this, localStates);
+            while (!producer.postProduce(localStates.producer))
+               ;
+            return ConsumerExtraWork;
+         }
+         case ConsumerExtraWork: {
+            auto nextStepId = consumer.extraWork(localStates.consumer, innerStepId);
+            return nextStepId == Consumer::extraWorkDone ? extraWorkDone : ConsumerExtraWork | checkStepId(nextStepId);
+         }
+      }
+      __builtin_unreachable();
+   }
+
+   /// Whether a step of extraWork() is a serial section of one of the UDOs
+   static constexpr bool isSerialStep(uint32_t stepId) {
+      switch (stepId & ~stepMask) {
+         case ProducerExtraWork: return Producer::isSerialStep(stepId & stepMask);
+         case ConsumerExtraWork: return Consumer::isSerialStep(stepId & stepMask);
+         default: return false;
+      }
+   }
+
+   /// Get the name of a step of extraWork() for traces
+   static const char* getStepName(uint32_t stepId) {
+      switch (stepId & ~stepMask) {
+         case ProducerExtraWork:
+            if constexpr (requires { Producer::getStepName(stepId); })
+               return Producer::getStepName(stepId & stepMask);
+            return nullptr;
+         case ProducerPostProduce: return "PipelineProduce";
+         case ConsumerExtraWork:
+            if constexpr (requires { Consumer::getStepName(stepId); })
+               return Consumer::getStepName(stepId & stepMask);
+            return nullptr;
+         default: return nullptr;
+      }
+   }
+
+   /// Generate the output of the consumer
+   bool postProduce(LocalState& localState) {
+      return consumer.postProduce(getLocalStates(localState).consumer);
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
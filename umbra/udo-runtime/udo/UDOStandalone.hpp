@@ -1,15 +1,33 @@
 #ifndef H_udo_runtime_UDOStandalone
 #define H_udo_runtime_UDOStandalone
 //---------------------------------------------------------------------------
+#include "udo/Arena.hpp"
+#include "udo/Barrier.hpp"
+#include "udo/Columns.hpp"
+#include "udo/FileBlockStream.hpp"
+#include "udo/HugePages.hpp"
+#include "udo/MorselScheduler.hpp"
+#include "udo/PerfCounters.hpp"
+#include "udo/Random.hpp"
+#include "udo/Topology.hpp"
+#include "udo/Trace.hpp"
 #include "udo/UDOperator.hpp"
+#include "udo/WorkerPool.hpp"
+#include <algorithm>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <random>
 #include <span>
+#include <string>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 //---------------------------------------------------------------------------
 namespace udo {
@@ -23,25 +41,368 @@ void printDebug(const char* msg, uint64_t size)
 uint64_t getRandom()
 // Get a random number
 {
-   auto rand = std::random_device();
-   std::uniform_int_distribution<uint64_t> distr;
-   return distr(rand);
+   // Only the generator of each thread is seeded from the random device,
+   // which costs a system call
+   thread_local RandomGenerator generator([] {
+      std::random_device device;
+      return (static_cast<uint64_t>(device()) << 32) | device();
+   }());
+   return generator();
 }
 //---------------------------------------------------------------------------
-/// The common base class for the UDOStandalone class below
+/// The id of the worker that runs on the current thread
+thread_local uint32_t standaloneWorkerId = ~0u;
+//---------------------------------------------------------------------------
+uint32_t getWorkerId()
+// Get the dense id of the worker that runs on the current thread
+{
+   return standaloneWorkerId;
+}
+//---------------------------------------------------------------------------
+/// The heap for the output strings of the worker that runs on the current
+/// thread. It is set by the standalone runtime.
+thread_local Arena* standaloneStringHeap = nullptr;
+//---------------------------------------------------------------------------
+String makeStandaloneOutputString(std::string_view value)
+// Copy a long string into the string heap of the current worker
+{
+   if (value.size() <= 12)
+      return String(value);
+   if (!standaloneStringHeap) {
+      printDebug("makeOutputString() must be called by a worker\n");
+      std::abort();
+   }
+   auto* data = static_cast<char*>(standaloneStringHeap->allocate(value.size(), 1));
+   std::memcpy(data, value.data(), value.size());
+   return String(std::string_view(data, value.size()));
+}
+//---------------------------------------------------------------------------
+/// Allocate a buffer for the input of UDOs that run on the workers of a pool.
+/// Every worker calls initialize(values, offset) for the part of the buffer
+/// that the morsel scheduler assigns to it, so the pages are faulted in on
+/// the NUMA node of the worker that will consume them. initialize must write
+/// all values of its part.
+template <typename T, typename F>
+HugePageBuffer<T> allocateInputBuffer(WorkerPool& pool, size_t size, F&& initialize, HugePages hugePages = HugePages::Transparent) {
+   HugePageBuffer<T> buffer(size, hugePages);
+   MorselScheduler scheduler(pool.getWorkerNodes(), MorselScheduler::adaptiveMorselSize);
+   pool.run(pool.size(), [&](size_t workerId) {
+      auto partition = scheduler.getPartition(workerId, size);
+      initialize(std::span<T>(buffer.data() + partition.begin, partition.end - partition.begin), partition.begin);
+   });
+   return buffer;
+}
+//---------------------------------------------------------------------------
+/// Allocate a buffer for the input of UDOs that run on the workers of a pool
+/// and let every worker touch the part it will consume. The values are zero.
+template <typename T>
+HugePageBuffer<T> allocateInputBuffer(WorkerPool& pool, size_t size, HugePages hugePages = HugePages::Transparent) {
+   HugePageBuffer<T> buffer(size, hugePages);
+   MorselScheduler scheduler(pool.getWorkerNodes(), MorselScheduler::adaptiveMorselSize);
+   pool.run(pool.size(), [&](size_t workerId) {
+      auto partition = scheduler.getPartition(workerId, size);
+      buffer.touch(partition.begin, partition.end);
+   });
+   return buffer;
+}
+//---------------------------------------------------------------------------
+/// The common base class for the UDOStandalone class below. Workers reserve
+/// blocks of output slots and write their tuples directly into them, so the
+/// shared output index is only touched once per block. The output is either
+/// a span given by the caller or chunks that every worker allocates on demand.
 template <typename OT>
 class UDOStandaloneBase {
+   public:
+   /// A function of another UDO that consumes the tuples the current worker
+   /// produces instead of the output. It is used to pipeline UDOs.
+   struct OutputSink {
+      /// The function that consumes the tuples
+      void (*consume)(void* context, std::span<const OT> outputs) = nullptr;
+      /// The argument for the function
+      void* context = nullptr;
+   };
+
    protected:
+   /// The number of output slots a worker reserves at once
+   static constexpr uint64_t outputBlockSize = 1024;
+   /// The maximum number of tuples in an output chunk
+   static constexpr uint64_t maxOutputChunkSize = 1ull << 20;
+
+   /// The deleter for output chunks
+   struct ChunkDeleter {
+      /// The size of the mapping if the chunk was mapped, 0 if it was
+      /// allocated with malloc()
+      size_t mappingSize = 0;
+
+      void operator()(OT* ptr) const {
+         if (mappingSize)
+            ::munmap(ptr, mappingSize);
+         else
+            std::free(ptr);
+      }
+   };
+
+   /// A chunk of the chunked output
+   struct OutputChunk {
+      /// The tuples. The memory is not initialized, so the pages are only
+      /// touched when tuples are written, i.e. by the worker that owns the
+      /// chunk. Large chunks are mapped with transparent huge pages.
+      std::unique_ptr<OT, ChunkDeleter> data;
+      /// The number of tuples the chunk can hold
+      uint64_t capacity;
+      /// The number of tuples in the chunk
+      uint64_t size = 0;
+   };
+
+   /// The output slots of a worker that were reserved but not filled yet
+   struct OutputBlock {
+      /// The next free slot
+      OT* next = nullptr;
+      /// The end of the reserved slots
+      OT* end = nullptr;
+      /// Is the output exhausted, i.e. no more slots can be reserved?
+      bool exhausted = false;
+      /// The number of tuples this worker produced
+      uint64_t numProduced = 0;
+      /// The tuples that did not fit into the output anymore. They are used
+      /// to fill the slots other workers reserved but did not use.
+      std::vector<OT> overflow;
+      /// The chunks of this worker when the output is chunked
+      std::vector<OutputChunk> chunks;
+      /// The sink that currently receives the tuples of this worker, if any
+      OutputSink sink;
+   };
+
    /// The output for the running UDO
    static std::span<OT> standaloneOutput;
-   /// The next valid index to write an output tuple
+   /// Is the output stored in chunks instead of standaloneOutput?
+   static bool standaloneChunkedOutput;
+   /// The chunks of all finished workers when the output is chunked
+   static std::vector<OutputChunk> standaloneOutputChunks;
+   /// The next output index that was not reserved yet
    static std::atomic<uint64_t> standaloneOutputIndex;
+   /// The number of tuples in the output after the run finished
+   static uint64_t standaloneOutputSize;
+   /// The number of workers of the running UDO
+   static uint64_t standaloneNumWorkers;
+   /// The output block of the current worker
+   static thread_local OutputBlock outputBlock;
+   /// The mutex that protects the finished output state below
+   static std::mutex finishedOutputMutex;
+   /// The output slots that workers reserved but did not use
+   static std::vector<std::pair<uint64_t, uint64_t>> unusedOutputSlots;
+   /// The tuples of all workers that did not fit into their blocks
+   static std::vector<OT> overflowOutput;
+   /// The total number of tuples produced by all finished workers
+   static uint64_t numProducedOutput;
+
+   /// Close the current chunk of the worker
+   static void closeOutputChunk() {
+      auto& block = outputBlock;
+      if (!block.chunks.empty())
+         block.chunks.back().size = block.next - block.chunks.back().data.get();
+   }
+
+   /// Allocate a new output chunk for the worker with at least the given size
+   static void addOutputChunk(uint64_t minSize) {
+      static_assert(std::is_trivially_copyable_v<OT>, "chunked output requires trivially copyable tuples");
+      auto& block = outputBlock;
+      closeOutputChunk();
+
+      // Every new chunk is twice as large as the previous one
+      uint64_t capacity = outputBlockSize;
+      if (!block.chunks.empty())
+         capacity = std::min(block.chunks.back().capacity * 2, maxOutputChunkSize);
+      capacity = std::max(capacity, minSize);
+
+      // Large chunks are mapped directly, so that they can use huge pages
+      // that are faulted in lazily by this worker
+      ChunkDeleter deleter;
+      OT* data;
+      if (capacity * sizeof(OT) >= hugePageSize) {
+         deleter.mappingSize = (capacity * sizeof(OT) + hugePageSize - 1) & ~(hugePageSize - 1);
+         bool isHugePage;
+         data = static_cast<OT*>(mapMemory(deleter.mappingSize, HugePages::Transparent, isHugePage));
+      } else {
+         data = static_cast<OT*>(std::malloc(capacity * sizeof(OT)));
+      }
+      if (!data) {
+         printDebug("out of memory for the output\n");
+         std::abort();
+      }
+      block.chunks.push_back({std::unique_ptr<OT, ChunkDeleter>(data, deleter), capacity});
+      block.next = data;
+      block.end = data + capacity;
+   }
+
+   /// Reserve a new output block with at least the given number of slots
+   static void reserveOutputBlock(uint64_t minSize) {
+      auto& block = outputBlock;
+      if (standaloneChunkedOutput) {
+         addOutputChunk(minSize);
+         return;
+      }
+      if (block.exhausted)
+         return;
+
+      auto size = std::max(minSize, outputBlockSize);
+      auto begin = standaloneOutputIndex.fetch_add(size, std::memory_order_relaxed);
+      if (begin >= standaloneOutput.size()) {
+         block.next = block.end = nullptr;
+         block.exhausted = true;
+         return;
+      }
+
+      auto end = std::min<uint64_t>(begin + size, standaloneOutput.size());
+      block.next = standaloneOutput.data() + begin;
+      block.end = standaloneOutput.data() + end;
+   }
+
+   /// Store a tuple that did not fit into the output
+   static void addOverflowTuple(const OT& output) {
+      // All unused slots together are less than one block per worker, so
+      // more overflow tuples can never be placed.
+      auto& overflow = outputBlock.overflow;
+      if (overflow.size() < standaloneNumWorkers * outputBlockSize)
+         overflow.push_back(output);
+   }
+
+   /// Prepare the output for a new run. Without an output span the output is
+   /// chunked.
+   static void beginOutput(std::optional<std::span<OT>> output, uint64_t numWorkers) {
+      standaloneOutput = output.value_or(std::span<OT>());
+      standaloneChunkedOutput = !output;
+      standaloneOutputChunks.clear();
+      standaloneOutputIndex.store(0);
+      standaloneOutputSize = 0;
+      standaloneNumWorkers = numWorkers;
+      unusedOutputSlots.clear();
+      overflowOutput.clear();
+      numProducedOutput = 0;
+   }
+
+   /// Prepare the output of the current worker
+   static void beginWorkerOutput() {
+      auto& block = outputBlock;
+      block.next = block.end = nullptr;
+      block.exhausted = false;
+      block.numProduced = 0;
+      block.overflow.clear();
+      block.chunks.clear();
+   }
+
+   /// Hand back the unused output of the current worker
+   static void finishWorkerOutput() {
+      auto& block = outputBlock;
+      closeOutputChunk();
+      std::unique_lock lock(finishedOutputMutex);
+      for (auto& chunk : block.chunks)
+         if (chunk.size > 0)
+            standaloneOutputChunks.push_back(std::move(chunk));
+      block.chunks.clear();
+      if (!standaloneChunkedOutput && block.next != block.end)
+         unusedOutputSlots.emplace_back(block.next - standaloneOutput.data(), block.end - standaloneOutput.data());
+      overflowOutput.insert(overflowOutput.end(), block.overflow.begin(), block.overflow.end());
+      numProducedOutput += block.numProduced;
+      block.next = block.end = nullptr;
+      block.overflow.clear();
+   }
+
+   /// Close the gaps that unused output slots left in the output after all
+   /// workers finished. Returns the total number of produced tuples.
+   static uint64_t finishOutput() {
+      if (standaloneChunkedOutput) {
+         standaloneOutputSize = numProducedOutput;
+         return numProducedOutput;
+      }
+
+      auto& holes = unusedOutputSlots;
+      std::sort(holes.begin(), holes.end());
+
+      // Fill the unused slots with the tuples that did not fit
+      auto overflowIt = overflowOutput.begin();
+      for (auto& hole : holes)
+         for (; hole.first < hole.second && overflowIt != overflowOutput.end(); ++hole.first, ++overflowIt)
+            standaloneOutput[hole.first] = *overflowIt;
+      std::erase_if(holes, [](auto& hole) { return hole.first == hole.second; });
+
+      uint64_t reserved = std::min<uint64_t>(standaloneOutputIndex.load(), standaloneOutput.size());
+      uint64_t numHoleSlots = 0;
+      for (auto& hole : holes)
+         numHoleSlots += hole.second - hole.first;
+      uint64_t size = reserved - numHoleSlots;
+
+      // Move the last tuples into the remaining holes before the new end
+      uint64_t source = reserved;
+      size_t sourceHole = holes.size();
+      auto nextSource = [&] {
+         while (true) {
+            --source;
+            while (sourceHole > 0 && holes[sourceHole - 1].first > source)
+               --sourceHole;
+            if (sourceHole > 0 && source < holes[sourceHole - 1].second)
+               source = holes[sourceHole - 1].first;
+            else
+               return source;
+         }
+      };
+      for (auto& hole : holes) {
+         if (hole.first >= size)
+            break;
+         for (auto target = hole.first; target < std::min(hole.second, size); ++target)
+            standaloneOutput[target] = standaloneOutput[nextSource()];
+      }
+
+      standaloneOutputSize = size;
+      return numProducedOutput;
+   }
 
    public:
+   /// Redirect the tuples the current worker produces into a sink until it
+   /// is replaced again. Returns the previous sink.
+   static OutputSink exchangeOutputSink(OutputSink sink) {
+      return std::exchange(outputBlock.sink, sink);
+   }
+
+   /// Produce a single output tuple
    static void produceOutputTuple(const OT& output) noexcept {
-      uint64_t index = standaloneOutputIndex.fetch_add(1, std::memory_order_relaxed);
-      if (index < standaloneOutput.size())
-         standaloneOutput[index] = output;
+      auto& block = outputBlock;
+      if (block.sink.consume) [[unlikely]] {
+         block.sink.consume(block.sink.context, {&output, 1});
+         return;
+      }
+      ++block.numProduced;
+      if (block.next == block.end) [[unlikely]] {
+         reserveOutputBlock(1);
+         if (block.next == block.end) {
+            addOverflowTuple(output);
+            return;
+         }
+      }
+      *block.next++ = output;
+   }
+
+   /// Produce several output tuples at once
+   static void produceOutputTuples(std::span<const OT> outputs) noexcept {
+      auto& block = outputBlock;
+      if (block.sink.consume) [[unlikely]] {
+         block.sink.consume(block.sink.context, outputs);
+         return;
+      }
+      block.numProduced += outputs.size();
+      while (!outputs.empty()) {
+         if (block.next == block.end) {
+            reserveOutputBlock(outputs.size());
+            if (block.next == block.end) {
+               for (auto& output : outputs)
+                  addOverflowTuple(output);
+               return;
+            }
+         }
+         auto count = std::min<size_t>(block.end - block.next, outputs.size());
+         block.next = std::copy_n(outputs.begin(), count, block.next);
+         outputs = outputs.subspan(count);
+      }
    }
 };
 //---------------------------------------------------------------------------
@@ -49,14 +410,52 @@ class UDOStandaloneBase {
 template <typename OT>
 std::span<OT> udo::UDOStandaloneBase<OT>::standaloneOutput = {};
 //---------------------------------------------------------------------------
-// The next valid index to write an output tuple
+// Is the output stored in chunks?
+template <typename OT>
+bool udo::UDOStandaloneBase<OT>::standaloneChunkedOutput = false;
+//---------------------------------------------------------------------------
+// The chunks of all finished workers when the output is chunked
+template <typename OT>
+std::vector<typename udo::UDOStandaloneBase<OT>::OutputChunk> udo::UDOStandaloneBase<OT>::standaloneOutputChunks = {};
+//---------------------------------------------------------------------------
+// The next output index that was not reserved yet
 template <typename OT>
 std::atomic<uint64_t> udo::UDOStandaloneBase<OT>::standaloneOutputIndex = {};
 //---------------------------------------------------------------------------
+// The number of tuples in the output after the run finished
+template <typename OT>
+uint64_t udo::UDOStandaloneBase<OT>::standaloneOutputSize = 0;
+//---------------------------------------------------------------------------
+// The number of workers of the running UDO
+template <typename OT>
+uint64_t udo::UDOStandaloneBase<OT>::standaloneNumWorkers = 0;
+//---------------------------------------------------------------------------
+// The output block of the current worker
+template <typename OT>
+thread_local typename udo::UDOStandaloneBase<OT>::OutputBlock udo::UDOStandaloneBase<OT>::outputBlock = {};
+//---------------------------------------------------------------------------
+// The mutex that protects the finished output state
+template <typename OT>
+std::mutex udo::UDOStandaloneBase<OT>::finishedOutputMutex;
+//---------------------------------------------------------------------------
+// The output slots that workers reserved but did not use
+template <typename OT>
+std::vector<std::pair<uint64_t, uint64_t>> udo::UDOStandaloneBase<OT>::unusedOutputSlots = {};
+//---------------------------------------------------------------------------
+// The tuples of all workers that did not fit into their blocks
+template <typename OT>
+std::vector<OT> udo::UDOStandaloneBase<OT>::overflowOutput = {};
+//---------------------------------------------------------------------------
+// The total number of tuples produced by all finished workers
+template <typename OT>
+uint64_t udo::UDOStandaloneBase<OT>::numProducedOutput = 0;
+//---------------------------------------------------------------------------
 /// The helper class to run an UDO standalone, i.e. without the database.
 template <typename UDO>
 class UDOStandalone : public UDOStandaloneBase<typename UDO::OutputTuple> {
    private:
+   using Base = UDOStandaloneBase<typename UDO::OutputTuple>;
+
    /// The possible states of the execution
    enum class ExecutionState : uint32_t {
       Input = 0,
@@ -67,24 +466,209 @@ class UDOStandalone : public UDOStandaloneBase<typename UDO::OutputTuple> {
 
    /// The number of threads that should be used
    size_t numThreads;
-   /// The morsel size for the input
-   size_t morselSize;
+   /// The worker pool that runs the threads, if any
+   WorkerPool* pool = nullptr;
+   /// The placement policy of the workers
+   Placement placement;
+   /// The CPU every worker is pinned to
+   std::vector<CpuInfo> workerCpus;
+   /// The scheduler that hands out the input morsels
+   MorselScheduler scheduler;
 
-   /// The input for the UDO
+   /// The input for the UDO when it is passed as tuples
    std::span<const typename UDO::InputTuple> input;
-   /// The current index for the input
-   std::atomic<uint64_t> inputIndex;
+   /// The input for the UDO when it is passed as columns
+   const void* columnarInput = nullptr;
+   /// The function that passes a range of the columnar input to the UDO
+   void (*consumeColumnarMorsel)(UDO&, typename UDO::LocalState&, const void*, MorselScheduler::Morsel) = nullptr;
+   /// The input for the UDO when it is streamed from a file
+   FileBlockStream* streamInput = nullptr;
+   /// The function that parses the blocks of the stream
+   const void* streamParser = nullptr;
+   /// The function that parses the next block of the stream and passes it
+   /// to the UDO. Returns false at the end of the stream.
+   bool (*consumeStreamBlock)(UDOStandalone&, UDO&, typename UDO::LocalState&, size_t) = nullptr;
+   /// The tuples parsed from a block of the stream by a worker
+   struct alignas(64) StreamTuples {
+      /// The tuples
+      std::vector<typename UDO::InputTuple> tuples;
+   };
+   /// The parsed tuples of every worker, they are reused for all blocks
+   std::vector<StreamTuples> streamTuples;
    /// The last execution state (contains ExecutionState and the stepId of the UDO)
    uint64_t lastExecutionState;
-   /// The number of threads waiting for the next execution state
-   size_t numWaitingThreads;
-   /// The mutex to synchronize execution states
-   std::mutex executionMutex;
-   /// The condition variable to synchronize execution states
-   std::condition_variable executionCv;
+   /// The barrier to synchronize execution states
+   Barrier executionBarrier;
+   /// The trace of the last run, only recorded when UDO_TRACE is defined
+   Trace trace;
+   /// Should the hardware counters be sampled?
+   bool perfCountersEnabled = false;
+   /// The hardware counters of the last run per phase
+   PerfProfile perfProfile;
+   /// The memory use of the arenas every worker created. The counters are
+   /// allocated once because arenas that outlive a run, e.g. in WorkerStates
+   /// of the UDO, keep pointing to them, and they are zeroed for every run.
+   std::unique_ptr<ArenaUsage[]> arenaUsage;
+   /// The heaps for the output strings of every worker in the last run
+   std::unique_ptr<Arena[]> stringHeaps;
+
+   /// The phase key for the hardware counters of barrier waits
+   static constexpr uint64_t barrierPhase = ~0ull;
+
+   /// Get the function that names the steps of the UDO, if it has one
+   static constexpr Trace::StepNameFunction getStepNameFunction() {
+      if constexpr (requires(uint32_t stepId) { UDO::getStepName(stepId); })
+         return &UDO::getStepName;
+      else
+         return nullptr;
+   }
+
+   /// Does the UDO accept whole morsels with consumeBatch()?
+   static constexpr bool hasConsumeBatch = requires(UDO& udo, typename UDO::LocalState& localState, std::span<const typename UDO::InputTuple> tuples) {
+      udo.consumeBatch(localState, tuples);
+   };
+
+   /// Pass a morsel to the UDO
+   static void consumeMorsel(UDO& udo, typename UDO::LocalState& localState, std::span<const typename UDO::InputTuple> morsel) {
+      if constexpr (hasConsumeBatch) {
+         udo.consumeBatch(localState, morsel);
+      } else {
+         for (auto& tuple : morsel)
+            udo.consume(localState, tuple);
+      }
+   }
+
+   /// Does the UDO accept columnar morsels with consumeColumns()?
+   static constexpr bool hasConsumeColumns = requires(UDO& udo, typename UDO::LocalState& localState, const ColumnMorsel<typename UDO::InputColumns>& morsel) {
+      udo.consumeColumns(localState, morsel);
+   };
+
+   /// Pass a morsel of columnar input to the UDO
+   template <typename C>
+   static void consumeColumns(UDO& udo, typename UDO::LocalState& localState, const void* input, MorselScheduler::Morsel morsel) {
+      auto columnMorsel = static_cast<const ColumnarInput<C>*>(input)->getMorsel(morsel.begin, morsel.end);
+      if constexpr (hasConsumeColumns) {
+         udo.consumeColumns(localState, columnMorsel);
+      } else {
+         for (size_t i = 0; i < columnMorsel.size(); ++i)
+            udo.consume(localState, columnMorsel.getTuple(i));
+      }
+   }
+
+   /// Parse the next block of the stream and pass the tuples to the UDO
+   template <typename F>
+   static bool consumeParsedBlock(UDOStandalone& standalone, UDO& udo, typename UDO::LocalState& localState, size_t workerId) {
+      auto block = standalone.streamInput->next();
+      if (!block)
+         return false;
+
+      TraceScope traceScope(standalone.trace, workerId, TraceEvent::Morsel);
+      auto& tuples = standalone.streamTuples[workerId].tuples;
+      tuples.clear();
+      (*static_cast<const F*>(standalone.streamParser))(*block, tuples);
+      // Release the buffer before consuming, so that the next read can start
+      standalone.streamInput->release(*block);
+      traceScope.setArg(tuples.size());
+
+      consumeMorsel(udo, localState, tuples);
+      return true;
+   }
+
+   /// Pass the next morsel of the input to the UDO. Returns false when the
+   /// input is exhausted.
+   bool consumeNextMorsel(UDO& udo, typename UDO::LocalState& localState, size_t workerId) {
+      if (streamInput)
+         return consumeStreamBlock(*this, udo, localState, workerId);
+
+      auto morsel = scheduler.next(workerId);
+      if (!morsel)
+         return false;
+
+      TraceScope traceScope(trace, workerId, TraceEvent::Morsel, morsel->end - morsel->begin);
+      std::chrono::steady_clock::time_point morselStart;
+      if (scheduler.isAdaptive())
+         morselStart = std::chrono::steady_clock::now();
+      if (columnarInput)
+         consumeColumnarMorsel(udo, localState, columnarInput, *morsel);
+      else
+         consumeMorsel(udo, localState, input.subspan(morsel->begin, morsel->end - morsel->begin));
+      if (scheduler.isAdaptive())
+         scheduler.reportMorsel(workerId, *morsel, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - morselStart).count());
+      return true;
+   }
+
+   /// Run the UDO with the input that was set up by run()
+   uint64_t execute(UDO& udo, uint64_t inputSize, std::optional<std::span<typename UDO::OutputTuple>> output) {
+      scheduler.reset(inputSize);
+      lastExecutionState = 0;
+      if constexpr (traceEnabled)
+         trace.begin(numThreads, getStepNameFunction());
+      if (perfCountersEnabled)
+         perfProfile.begin(numThreads);
+      for (size_t i = 0; i < numThreads; ++i) {
+         arenaUsage[i].reservedBytes.store(0, std::memory_order_relaxed);
+         arenaUsage[i].hugePageBytes.store(0, std::memory_order_relaxed);
+         arenaUsage[i].allocatedBytes.store(0, std::memory_order_relaxed);
+      }
+      stringHeaps.reset(new Arena[numThreads]);
+
+      Base::beginOutput(output, numThreads);
+
+      if (pool) {
+         pool->run(numThreads, [this, &udo](size_t workerId) { threadMain(udo, workerId); });
+      } else {
+         std::vector<std::thread> threads;
+         threads.reserve(numThreads);
+
+         for (size_t i = 0; i < numThreads; ++i)
+            threads.emplace_back([this, &udo, i] {
+               pinCurrentThread(workerCpus[i].cpu);
+               threadMain(udo, i);
+            });
+
+         for (auto& t : threads)
+            t.join();
+      }
+
+      return Base::finishOutput();
+   }
+
+   /// Run the serial steps of extraWork() that follow the given execution
+   /// state. This is called by the last worker that arrives at the barrier,
+   /// so the other workers continue with the first step that is not serial.
+   uint64_t runSerialSteps(UDO& udo, size_t workerId, const PerfCounterGroup* perfCounters, uint64_t executionState) {
+      if (static_cast<ExecutionState>(executionState >> 32) != ExecutionState::ExtraWork)
+         return executionState;
+      if (perfCounters)
+         perfProfile.attribute(workerId, *perfCounters, barrierPhase);
+
+      typename UDO::LocalState localState;
+      auto stepId = static_cast<uint32_t>(executionState);
+      while (stepId != UDO::extraWorkDone && UDO::isSerialStep(stepId)) {
+         std::memset(localState.data, 0, sizeof(localState.data));
+         TraceScope traceScope(trace, workerId, TraceEvent::SerialStep, stepId);
+         auto serialStepId = stepId;
+         stepId = udo.extraWork(localState, stepId);
+         if (perfCounters)
+            perfProfile.attribute(workerId, *perfCounters, (static_cast<uint64_t>(ExecutionState::ExtraWork) << 32) | serialStepId);
+      }
+
+      if (stepId == UDO::extraWorkDone)
+         return static_cast<uint64_t>(ExecutionState::Output) << 32;
+      return (static_cast<uint64_t>(ExecutionState::ExtraWork) << 32) | stepId;
+   }
 
    /// The main function for the threads
-   void threadMain(UDO& udo) {
+   void threadMain(UDO& udo, size_t workerId) {
+      standaloneWorkerId = workerId;
+      currentArenaUsage = &arenaUsage[workerId];
+      standaloneStringHeap = &stringHeaps[workerId];
+      Base::beginWorkerOutput();
+      std::optional<PerfCounterGroup> perfCounters;
+      if (perfCountersEnabled) {
+         perfCounters.emplace();
+         perfProfile.start(workerId, *perfCounters);
+      }
       typename UDO::LocalState localState;
       while (true) {
          auto executionState = static_cast<ExecutionState>(lastExecutionState >> 32);
@@ -93,11 +677,10 @@ class UDOStandalone : public UDOStandaloneBase<typename UDO::OutputTuple> {
          switch (executionState) {
             case ExecutionState::Input: {
                std::memset(localState.data, 0, sizeof(localState.data));
-               auto startIndex = inputIndex.fetch_add(morselSize);
-               if (startIndex < input.size()) {
-                  for (size_t i = 0; i < morselSize && startIndex + i < input.size(); ++i)
-                     udo.consume(localState, input[startIndex + i]);
-               } else {
+               if (!consumeNextMorsel(udo, localState, workerId)) {
+                  // The input state of all workers starts with the run
+                  if constexpr (traceEnabled)
+                     trace.record(workerId, TraceEvent::Input, 0, 0, trace.now());
                   nextExecutionState = static_cast<uint64_t>(ExecutionState::ExtraWork) << 32;
                }
                break;
@@ -106,8 +689,10 @@ class UDOStandalone : public UDOStandaloneBase<typename UDO::OutputTuple> {
             case ExecutionState::ExtraWork: {
                std::memset(localState.data, 0, sizeof(localState.data));
                auto stepId = static_cast<uint32_t>(lastExecutionState);
-               if (stepId != UDO::extraWorkDone)
+               if (stepId != UDO::extraWorkDone) {
+                  TraceScope traceScope(trace, workerId, TraceEvent::ExtraWork, stepId);
                   stepId = udo.extraWork(localState, stepId);
+               }
 
                if (stepId == UDO::extraWorkDone) {
                   nextExecutionState = static_cast<uint64_t>(ExecutionState::Output) << 32;
@@ -119,67 +704,209 @@ class UDOStandalone : public UDOStandaloneBase<typename UDO::OutputTuple> {
 
             case ExecutionState::Output: {
                std::memset(localState.data, 0, sizeof(localState.data));
-               while (!udo.postProduce(localState))
-                  ;
+               {
+                  TraceScope traceScope(trace, workerId, TraceEvent::Output);
+                  while (!udo.postProduce(localState))
+                     ;
+               }
                nextExecutionState = static_cast<uint64_t>(ExecutionState::End) << 32;
+               [[fallthrough]];
             }
 
             case ExecutionState::End:
+               if (perfCounters)
+                  perfProfile.attribute(workerId, *perfCounters, lastExecutionState);
+               Base::finishWorkerOutput();
+               standaloneWorkerId = ~0u;
+               currentArenaUsage = nullptr;
+               standaloneStringHeap = nullptr;
                return;
          }
 
          if (nextExecutionState != lastExecutionState) {
-            std::unique_lock lock(executionMutex);
-            ++numWaitingThreads;
-            if (numWaitingThreads == numThreads) {
-               lastExecutionState = nextExecutionState;
-               numWaitingThreads = 0;
-               executionCv.notify_all();
-            } else {
-               auto localExecutionState = lastExecutionState;
-               executionCv.wait(lock, [&] { return localExecutionState != lastExecutionState; });
+            // For the last worker to arrive, this includes the serial steps
+            if (perfCounters)
+               perfProfile.attribute(workerId, *perfCounters, lastExecutionState);
+            {
+               TraceScope traceScope(trace, workerId, TraceEvent::BarrierWait, nextExecutionState);
+               executionBarrier.arriveAndWait([&] { lastExecutionState = runSerialSteps(udo, workerId, perfCounters ? &*perfCounters : nullptr, nextExecutionState); });
             }
+            if (perfCounters)
+               perfProfile.attribute(workerId, *perfCounters, barrierPhase);
          }
       }
    };
 
+   /// Get the NUMA node of every worker
+   static std::vector<unsigned> getWorkerNodes(std::span<const CpuInfo> workerCpus) {
+      std::vector<unsigned> workerNodes;
+      for (auto& info : workerCpus)
+         workerNodes.push_back(info.node);
+      return workerNodes;
+   }
+
    public:
-   /// Constructor
-   explicit UDOStandalone(size_t numThreads, size_t morselSize = 1000)
-      : numThreads(numThreads), morselSize(morselSize) {}
+   /// Constructor. The threads are pinned to the CPUs chosen by the
+   /// placement policy. By default, the morsel size adapts to the measured
+   /// cost of consuming the input.
+   explicit UDOStandalone(size_t numThreads, size_t morselSize = MorselScheduler::adaptiveMorselSize, Placement placement = Placement::Compact)
+      : numThreads(std::max<size_t>(numThreads, 1)), placement(placement), workerCpus(Topology::detect().getWorkerCpus(this->numThreads, placement)),
+        scheduler(getWorkerNodes(workerCpus), morselSize), executionBarrier(this->numThreads), arenaUsage(new ArenaUsage[this->numThreads]) {}
+   /// Constructor that borrows the threads of a worker pool instead of
+   /// starting new threads for every run
+   explicit UDOStandalone(WorkerPool& pool, size_t morselSize = MorselScheduler::adaptiveMorselSize)
+      : numThreads(pool.size()), pool(&pool), placement(pool.getPlacement()), workerCpus(pool.getWorkerCpus().begin(), pool.getWorkerCpus().end()),
+        scheduler(pool.getWorkerNodes(), morselSize), executionBarrier(numThreads), arenaUsage(new ArenaUsage[numThreads]) {}
 
-   /// Get the output generated by the UDO
-   static std::span<typename UDO::OutputTuple> getOutput() {
-      auto size = UDOStandaloneBase<typename UDO::OutputTuple>::standaloneOutputIndex.load();
-      auto totalOutput = UDOStandaloneBase<typename UDO::OutputTuple>::standaloneOutput;
-      return totalOutput.subspan(0, size);
+   /// Get the CPU every worker is pinned to
+   std::span<const CpuInfo> getWorkerCpus() const {
+      return workerCpus;
    }
 
-   /// Run this UDO with the given input
-   uint64_t run(UDO& udo, std::span<const typename UDO::InputTuple> input, std::span<typename UDO::OutputTuple> output) {
-      this->input = input;
-      inputIndex.store(0);
-      lastExecutionState = 0;
-      numWaitingThreads = 0;
+   /// Print the placement policy and the CPU of every worker
+   void printPlacement(std::ostream& out) const {
+      udo::printPlacement(out, placement, workerCpus);
+   }
 
-      UDOStandaloneBase<typename UDO::OutputTuple>::standaloneOutput = output;
-      auto& outputIndex = UDOStandaloneBase<typename UDO::OutputTuple>::standaloneOutputIndex;
-      outputIndex.store(0);
+   /// Get the trace of the last run. It is only recorded when the runtime is
+   /// compiled with UDO_TRACE. Steps are named by a static getStepName()
+   /// function of the UDO, if it has one.
+   const Trace& getTrace() const {
+      return trace;
+   }
 
-      size_t realNumThreads = numThreads;
-      if (realNumThreads == 0)
-         realNumThreads = 1;
+   /// Sample hardware counters per worker in the following runs. Returns
+   /// false and leaves them disabled when the kernel does not provide them,
+   /// e.g. in containers or because of perf_event_paranoid.
+   bool setPerfCounters(bool enabled) {
+      perfCountersEnabled = false;
+      if (!enabled)
+         return true;
+      if (int error = PerfCounterGroup::probe()) {
+         std::string message = "hardware counters are not available: ";
+         message += std::strerror(error);
+         message += '\n';
+         printDebug(message);
+         return false;
+      }
+      perfCountersEnabled = true;
+      return true;
+   }
 
-      std::vector<std::thread> threads;
-      threads.reserve(realNumThreads);
+   /// Print the hardware counters of the last run per execution state and
+   /// step of extraWork(), summed over all workers
+   void printPerfCounters(std::ostream& out) const {
+      if (perfProfile.empty()) {
+         out << "no hardware counters were sampled\n";
+         return;
+      }
+      perfProfile.print(out, [](uint64_t phase) -> std::string {
+         if (phase == barrierPhase)
+            return "Barrier";
+         auto stepId = static_cast<uint32_t>(phase);
+         switch (static_cast<ExecutionState>(phase >> 32)) {
+            case ExecutionState::Input: return "Input";
+            case ExecutionState::ExtraWork:
+               if (auto getStepName = getStepNameFunction())
+                  if (auto* name = getStepName(stepId))
+                     return name;
+               return "Step " + std::to_string(stepId);
+            case ExecutionState::Output: return "Output";
+            case ExecutionState::End: return "End";
+         }
+         __builtin_unreachable();
+      });
+   }
 
-      for (size_t i = 0; i < realNumThreads; ++i)
-         threads.emplace_back([this, &udo] { threadMain(udo); });
+   /// Print the memory the arenas of the UDO reserved and allocated in the
+   /// last run, summed over all workers and for the worker that used the most
+   void printArenaUsage(std::ostream& out) const {
+      uint64_t reservedBytes = 0;
+      uint64_t hugePageBytes = 0;
+      uint64_t allocatedBytes = 0;
+      uint64_t maxReservedBytes = 0;
+      for (size_t i = 0; i < numThreads; ++i) {
+         auto workerReservedBytes = arenaUsage[i].reservedBytes.load();
+         reservedBytes += workerReservedBytes;
+         hugePageBytes += arenaUsage[i].hugePageBytes.load();
+         allocatedBytes += arenaUsage[i].allocatedBytes.load();
+         maxReservedBytes = std::max(maxReservedBytes, workerReservedBytes);
+      }
+      auto mib = [](uint64_t bytes) { return bytes / double(1u << 20); };
+      out << "arena memory: reserved " << mib(reservedBytes) << " MiB (" << mib(hugePageBytes) << " MiB huge pages), allocated " << mib(allocatedBytes) << " MiB, max per worker " << mib(maxReservedBytes) << " MiB\n";
+   }
 
-      for (auto& t : threads)
-         t.join();
+   /// Get the output generated by the UDO when it was written into a span
+   static std::span<typename UDO::OutputTuple> getOutput() {
+      return Base::standaloneOutput.subspan(0, Base::standaloneOutputSize);
+   }
+
+   /// Get the number of tuples in the output
+   static uint64_t getOutputSize() {
+      return Base::standaloneOutputSize;
+   }
+
+   /// Get the output generated by the UDO as a list of contiguous chunks
+   static std::vector<std::span<typename UDO::OutputTuple>> getOutputChunks() {
+      std::vector<std::span<typename UDO::OutputTuple>> chunks;
+      if (Base::standaloneChunkedOutput) {
+         for (auto& chunk : Base::standaloneOutputChunks)
+            chunks.emplace_back(chunk.data.get(), chunk.size);
+      } else if (Base::standaloneOutputSize > 0) {
+         chunks.push_back(getOutput());
+      }
+      return chunks;
+   }
+
+   /// Run this UDO with the given input and write the output into chunks
+   /// that grow on demand
+   uint64_t run(UDO& udo, std::span<const typename UDO::InputTuple> input) {
+      return run(udo, input, std::nullopt);
+   }
+
+   /// Run this UDO with the given input. When an output span is given, all
+   /// tuples that do not fit into it are dropped. Strings that the UDO made
+   /// with makeOutputString() stay valid until the next run.
+   uint64_t run(UDO& udo, std::span<const typename UDO::InputTuple> input, std::optional<std::span<typename UDO::OutputTuple>> output) {
+      this->input = input;
+      columnarInput = nullptr;
+      streamInput = nullptr;
+      return execute(udo, input.size(), output);
+   }
 
-      return outputIndex.load();
+   /// Run this UDO with columnar input. The UDO must describe its input
+   /// columns with an InputColumns type. It gets the columns through
+   /// consumeColumns() if it defines it and assembled tuples otherwise.
+   template <typename C>
+      requires std::is_same_v<C, typename UDO::InputColumns>
+   uint64_t run(UDO& udo, const ColumnarInput<C>& input, std::optional<std::span<typename UDO::OutputTuple>> output = std::nullopt) {
+      this->input = {};
+      columnarInput = &input;
+      consumeColumnarMorsel = &consumeColumns<C>;
+      streamInput = nullptr;
+      return execute(udo, input.size(), output);
+   }
+
+   /// Run this UDO with input that is streamed from a file. The workers take
+   /// the blocks of the stream one after the other and call
+   ///    parse(const FileBlockStream::Block& block, std::vector<InputTuple>& tuples)
+   /// to append the tuples of the lines in a block, which are then passed to
+   /// the UDO as one morsel. Reading, parsing and consuming overlap, and only
+   /// the buffers of the stream and one block of tuples per worker are in
+   /// memory at any time.
+   template <typename F>
+   uint64_t run(UDO& udo, FileBlockStream& input, const F& parse, std::optional<std::span<typename UDO::OutputTuple>> output = std::nullopt) {
+      this->input = {};
+      columnarInput = nullptr;
+      streamInput = &input;
+      // Functions are passed as function pointers
+      const std::decay_t<F>& parser = parse;
+      streamParser = &parser;
+      consumeStreamBlock = &consumeParsedBlock<std::decay_t<F>>;
+      streamTuples.resize(numThreads);
+      auto result = execute(udo, 0, output);
+      streamInput = nullptr;
+      return result;
    }
 };
 //---------------------------------------------------------------------------
@@ -188,6 +915,16 @@ void UDOperator<IT, OT>::produceOutputTuple(const OT& output) noexcept {
    UDOStandaloneBase<OT>::produceOutputTuple(output);
 }
 //---------------------------------------------------------------------------
+template <typename IT, typename OT>
+void UDOperator<IT, OT>::produceOutputTuples(std::span<const OT> outputs) noexcept {
+   UDOStandaloneBase<OT>::produceOutputTuples(outputs);
+}
+//---------------------------------------------------------------------------
+template <typename IT, typename OT>
+String UDOperator<IT, OT>::makeOutputString(std::string_view value) noexcept {
+   return makeStandaloneOutputString(value);
+}
+//---------------------------------------------------------------------------
 }
 //---------------------------------------------------------------------------
 #endif
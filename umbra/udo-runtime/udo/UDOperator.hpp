@@ -1,9 +1,13 @@
 #ifndef H_udo_runtime_UDOperator
 #define H_udo_runtime_UDOperator
 //---------------------------------------------------------------------------
+#include <algorithm>
+#include <compare>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <functional>
+#include <span>
 #include <string_view>
 //---------------------------------------------------------------------------
 namespace udo {
@@ -19,12 +23,20 @@ void printDebug(std::string_view message) {
 /// Get a random number
 uint64_t getRandom();
 //---------------------------------------------------------------------------
+/// Get the dense id of the worker that runs on the current thread. Only
+/// provided by the standalone runtime.
+uint32_t getWorkerId();
+//---------------------------------------------------------------------------
 /// The data128 type used for strings
 struct data128_t {
    uint64_t values[2];
 };
 //---------------------------------------------------------------------------
-/// A string value than can be used in a tuple
+/// A string value than can be used in a tuple. The 16 byte header holds the
+/// size and the first 4 bytes of the string. Strings of at most 12 bytes are
+/// stored completely inline, longer strings store a pointer to their data
+/// after the prefix. Comparisons and hashing look at the header first, so
+/// most mismatches are found without dereferencing the pointer.
 class String {
    private:
    /// The string data
@@ -32,6 +44,28 @@ class String {
 
    /// The short string limit
    static constexpr uint32_t shortStringLimit = 12;
+   /// The size of the prefix of long strings
+   static constexpr uint32_t prefixSize = 4;
+
+   /// Get the first 4 bytes of the string, padded with zero bytes
+   uint32_t getPrefix() const {
+      uint32_t prefix;
+      std::memcpy(&prefix, reinterpret_cast<const char*>(&stringData) + sizeof(uint32_t), sizeof(uint32_t));
+      return prefix;
+   }
+
+   /// Load 8 bytes for hashing, only the first size bytes are used
+   static uint64_t loadPartial(const char* data, size_t size) {
+      uint64_t value = 0;
+      std::memcpy(&value, data, size);
+      return value;
+   }
+
+   /// Mix a value into a hash
+   static uint64_t mixHash(uint64_t hash, uint64_t value) {
+      auto product = static_cast<unsigned __int128>(hash ^ value) * 0x9e3779b97f4a7c15ull;
+      return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+   }
 
    public:
    /// Default constructor
@@ -44,9 +78,14 @@ class String {
       return s;
    }
 
+   /// Is the string stored inline?
+   bool isShort() const {
+      return size() <= shortStringLimit;
+   }
+
    /// Get the pointer to the string
    const char* data() const {
-      if (size() <= shortStringLimit) {
+      if (isShort()) {
          return reinterpret_cast<const char*>(reinterpret_cast<const char*>(&stringData) + sizeof(uint32_t));
       } else {
          uintptr_t rawPtr = stringData.values[1];
@@ -62,7 +101,7 @@ class String {
       if (size <= shortStringLimit) {
          std::memcpy(reinterpret_cast<char*>(&stringData) + sizeof(uint32_t), sv.data(), size);
       } else {
-         std::memset(reinterpret_cast<char*>(&stringData) + sizeof(uint32_t), 0, sizeof(uint32_t));
+         std::memcpy(reinterpret_cast<char*>(&stringData) + sizeof(uint32_t), sv.data(), prefixSize);
          uintptr_t rawPtr = reinterpret_cast<uintptr_t>(sv.data());
          rawPtr |= 1ull << 62;
          stringData.values[1] = rawPtr;
@@ -73,6 +112,69 @@ class String {
    operator std::string_view() const {
       return {data(), size()};
    }
+
+   /// Does the string start with the given prefix?
+   bool startsWith(std::string_view prefix) const {
+      if (prefix.size() > size())
+         return false;
+      // The first bytes are always in the header
+      auto headerSize = std::min<size_t>(prefix.size(), isShort() ? shortStringLimit : prefixSize);
+      auto* header = reinterpret_cast<const char*>(&stringData) + sizeof(uint32_t);
+      if (std::memcmp(header, prefix.data(), headerSize) != 0)
+         return false;
+      return headerSize == prefix.size() || std::memcmp(data() + headerSize, prefix.data() + headerSize, prefix.size() - headerSize) == 0;
+   }
+
+   /// Hash the string. Equal strings have the same hash regardless of where
+   /// their data is stored.
+   uint64_t hash() const {
+      // The size and prefix are hashed from the header
+      auto hash = mixHash(0x2d358dccaa6c78a5ull, stringData.values[0]);
+      auto size = this->size();
+      if (size <= shortStringLimit)
+         return mixHash(hash, stringData.values[1]);
+
+      auto* data = this->data();
+      size_t i = prefixSize;
+      for (; i + 8 <= size; i += 8)
+         hash = mixHash(hash, loadPartial(data + i, 8));
+      if (i < size)
+         hash = mixHash(hash, loadPartial(data + i, size - i));
+      return mixHash(hash, size);
+   }
+
+   /// Compare two strings for equality
+   friend bool operator==(const String& a, const String& b) {
+      // The size and the prefix
+      if (a.stringData.values[0] != b.stringData.values[0])
+         return false;
+      if (a.isShort())
+         return a.stringData.values[1] == b.stringData.values[1];
+      return std::memcmp(a.data() + prefixSize, b.data() + prefixSize, a.size() - prefixSize) == 0;
+   }
+   /// Compare a string with a string_view for equality
+   friend bool operator==(const String& a, std::string_view b) {
+      return a == String(b);
+   }
+
+   /// Compare two strings lexicographically
+   friend std::strong_ordering operator<=>(const String& a, const String& b) {
+      // The prefixes are padded with zero bytes, so comparing them as big
+      // endian numbers orders them like the strings unless they are equal
+      if (auto aPrefix = a.getPrefix(), bPrefix = b.getPrefix(); aPrefix != bPrefix)
+         return __builtin_bswap32(aPrefix) <=> __builtin_bswap32(bPrefix);
+      auto aSize = a.size(), bSize = b.size();
+      auto minSize = std::min(aSize, bSize);
+      if (minSize > prefixSize) {
+         if (auto cmp = std::memcmp(a.data() + prefixSize, b.data() + prefixSize, minSize - prefixSize); cmp != 0)
+            return cmp <=> 0;
+      }
+      return aSize <=> bSize;
+   }
+   /// Compare a string with a string_view lexicographically
+   friend std::strong_ordering operator<=>(const String& a, std::string_view b) {
+      return a <=> String(b);
+   }
 };
 //---------------------------------------------------------------------------
 struct EmptyTuple {
@@ -98,16 +200,70 @@ class UDOperator {
    /// Produce a tuple as output
    static void produceOutputTuple(const OutputTuple& output) noexcept;
 
+   /// Produce several tuples as output
+   static void produceOutputTuples(std::span<const OutputTuple> outputs) noexcept;
+
+   /// Make a string for an output tuple whose data lives as long as the
+   /// output. The standalone runtime copies long strings into a heap of the
+   /// current worker that is released with the output, so the value can be
+   /// a temporary buffer. The database copies the strings of a tuple in
+   /// produceOutputTuple(), so there the value must stay valid until then.
+   static String makeOutputString(std::string_view value) noexcept;
+
    /// Accept an incoming tuple
    void consume(LocalState& /*localState*/, const InputTuple& /*input*/) {}
 
+   // A UDO may additionally define
+   //    void consumeBatch(LocalState& localState, std::span<const InputTuple> inputs)
+   // The standalone runtime detects it and passes whole morsels to it instead
+   // of calling consume() for every tuple, so loops over a morsel can be
+   // vectorized. It must have the same effect as calling consume() for all
+   // tuples of the morsel.
+   //
+   // A UDO may also describe its input attributes with a udo::Columns type
+   //    using InputColumns = udo::Columns<&InputTuple::a, &InputTuple::b>;
+   // and define
+   //    void consumeColumns(LocalState& localState, const udo::ColumnMorsel<InputColumns>& morsel)
+   // The standalone runtime can then deliver morsels of columnar input as one
+   // contiguous array per listed attribute.
+
    /// Do some extra work after all input tuples were consumed
    uint32_t extraWork(LocalState& /*localState*/, uint32_t /*stepId*/) { return extraWorkDone; }
 
+   /// Whether a step of extraWork() is a serial section. The standalone
+   /// runtime runs a serial step on a single worker right after all workers
+   /// finished the previous step, while the others wait for the step that
+   /// follows it, so a step that only does work in one thread needs no
+   /// barrier of its own. The database calls extraWork() for serial steps on
+   /// all workers, so they must still tolerate that, e.g. by guarding the
+   /// work with a flag.
+   static constexpr bool isSerialStep(uint32_t /*stepId*/) { return false; }
+
    /// Do work after all tuples were consumed and generate the output
    bool postProduce(LocalState& /*localState*/) { return true; }
 };
 //---------------------------------------------------------------------------
+#ifndef UDO_STANDALONE
+template <typename IT, typename OT>
+void UDOperator<IT, OT>::produceOutputTuples(std::span<const OT> outputs) noexcept {
+   // The database only provides produceOutputTuple()
+   for (auto& output : outputs)
+      produceOutputTuple(output);
 }
 //---------------------------------------------------------------------------
+template <typename IT, typename OT>
+String UDOperator<IT, OT>::makeOutputString(std::string_view value) noexcept {
+   // The database copies the string when the tuple is produced
+   return String(value);
+}
+#endif
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+/// Hash strings with udo::String::hash()
+template <>
+struct std::hash<udo::String> {
+   size_t operator()(const udo::String& value) const noexcept { return value.hash(); }
+};
+//---------------------------------------------------------------------------
 #endif
@@ -0,0 +1,138 @@
+#ifndef H_udo_runtime_WorkerPool
+#define H_udo_runtime_WorkerPool
+//---------------------------------------------------------------------------
+#include "udo/Topology.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// A set of long-lived worker threads that are pinned to CPUs. A pool can be
+/// shared by several UDOStandalone instances so that repeated runs do not pay
+/// for starting and joining threads.
+class WorkerPool {
+   private:
+   /// The threads of the pool
+   std::vector<std::thread> threads;
+   /// The placement policy of the workers
+   Placement placement;
+   /// The CPU every worker is pinned to
+   std::vector<CpuInfo> workerCpus;
+   /// The NUMA node of every worker
+   std::vector<unsigned> workerNodes;
+
+   /// The mutex that protects the job state
+   std::mutex mutex;
+   /// The condition variable on which idle workers wait for a job
+   std::condition_variable jobCv;
+   /// The condition variable on which run() waits for the job to finish
+   std::condition_variable doneCv;
+   /// The generation of the current job, incremented for every job
+   uint64_t jobGeneration = 0;
+   /// The function of the current job
+   void (*jobFunction)(void*, size_t) = nullptr;
+   /// The argument for the function of the current job
+   void* jobContext = nullptr;
+   /// The number of workers that take part in the current job
+   size_t jobWorkers = 0;
+   /// The number of workers that did not finish the current job yet
+   size_t runningWorkers = 0;
+   /// Are the workers asked to exit?
+   bool stopping = false;
+
+   /// The main function of a worker
+   void workerMain(size_t workerId) {
+      pinCurrentThread(workerCpus[workerId].cpu);
+
+      uint64_t seenGeneration = 0;
+      while (true) {
+         void (*function)(void*, size_t);
+         void* context;
+         {
+            std::unique_lock lock(mutex);
+            jobCv.wait(lock, [&] { return stopping || jobGeneration != seenGeneration; });
+            if (stopping)
+               return;
+            seenGeneration = jobGeneration;
+            if (workerId >= jobWorkers)
+               continue;
+            function = jobFunction;
+            context = jobContext;
+         }
+
+         function(context, workerId);
+
+         std::unique_lock lock(mutex);
+         if (--runningWorkers == 0)
+            doneCv.notify_all();
+      }
+   }
+
+   public:
+   /// Constructor. The workers are pinned to the CPUs of the topology that
+   /// are chosen by the placement policy.
+   explicit WorkerPool(size_t numThreads, Placement placement = Placement::Compact, const Topology& topology = Topology::detect()) : placement(placement) {
+      numThreads = std::max<size_t>(numThreads, 1);
+      workerCpus = topology.getWorkerCpus(numThreads, placement);
+      for (auto& info : workerCpus)
+         workerNodes.push_back(info.node);
+
+      threads.reserve(numThreads);
+      for (size_t i = 0; i < numThreads; ++i)
+         threads.emplace_back([this, i] { workerMain(i); });
+   }
+
+   /// Destructor
+   ~WorkerPool() {
+      {
+         std::unique_lock lock(mutex);
+         stopping = true;
+      }
+      jobCv.notify_all();
+      for (auto& thread : threads)
+         thread.join();
+   }
+
+   WorkerPool(const WorkerPool&) = delete;
+   WorkerPool& operator=(const WorkerPool&) = delete;
+
+   /// Get the number of workers
+   size_t size() const { return threads.size(); }
+   /// Get the NUMA node of every worker
+   std::span<const unsigned> getWorkerNodes() const { return workerNodes; }
+   /// Get the CPU of every worker
+   std::span<const CpuInfo> getWorkerCpus() const { return workerCpus; }
+   /// Get the placement policy
+   Placement getPlacement() const { return placement; }
+
+   /// Run a function on the first numWorkers workers and wait until all of
+   /// them returned. The function is called with the id of the worker. Jobs
+   /// from different threads are executed one after the other.
+   template <typename F>
+   void run(size_t numWorkers, F&& function) {
+      using Function = std::remove_reference_t<F>;
+      numWorkers = std::min(numWorkers, threads.size());
+      if (numWorkers == 0)
+         return;
+
+      std::unique_lock lock(mutex);
+      doneCv.wait(lock, [&] { return runningWorkers == 0; });
+      jobFunction = [](void* context, size_t workerId) { (*static_cast<Function*>(context))(workerId); };
+      jobContext = const_cast<std::remove_const_t<Function>*>(&function);
+      jobWorkers = numWorkers;
+      runningWorkers = numWorkers;
+      ++jobGeneration;
+      jobCv.notify_all();
+      doneCv.wait(lock, [&] { return runningWorkers == 0; });
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif
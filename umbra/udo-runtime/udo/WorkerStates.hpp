@@ -0,0 +1,129 @@
+#ifndef H_udo_runtime_WorkerStates
+#define H_udo_runtime_WorkerStates
+//---------------------------------------------------------------------------
+#include "udo/UDOperator.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#ifdef UDO_STANDALONE
+#include <array>
+#include <sched.h>
+#endif
+//---------------------------------------------------------------------------
+namespace udo {
+//---------------------------------------------------------------------------
+/// The per-worker states of a UDO. Every worker gets its own instance of the
+/// UDO-declared type T that is constructed on first use by the worker itself,
+/// so it lives in memory local to the worker, and that is kept until the
+/// states are cleared. Every state has its own cache lines. All states can
+/// be visited to merge them, e.g. in a step of extraWork() or in
+/// postProduce().
+///
+/// With the standalone runtime, the states are found by the dense worker id
+/// in a table of CPU_SETSIZE pointers (8 KiB per instance) and stay the same
+/// across morsels and phases. Otherwise, the state is cached in the
+/// LocalState which the database keeps for a worker. When the LocalState is
+/// zeroed, e.g. for every call of extraWork(), a new state is added, so such
+/// states should be cleared after they are merged.
+///
+/// The states are owned by the UDO rather than by the runtime, because the
+/// database has no interface to run a merge hook for them. The merge is part
+/// of a step of the UDO instead.
+template <typename T>
+class WorkerStates {
+   private:
+   /// The state of one worker
+   struct alignas(64) Entry {
+      /// The state
+      T state;
+      /// The next entry in the list of all entries
+      Entry* next = nullptr;
+
+      /// Constructor
+      template <typename F>
+      explicit Entry(F& construct) : state(construct()) {}
+   };
+
+   /// The list of all entries
+   std::atomic<Entry*> entries = nullptr;
+#ifdef UDO_STANDALONE
+   /// The entry of every worker, indexed by the worker id
+   std::array<Entry*, CPU_SETSIZE> workerEntries = {};
+#endif
+
+   /// Create a new entry and add it to the list of all entries
+   template <typename F>
+   Entry* addEntry(F& construct) {
+      auto* entry = new Entry(construct);
+      entry->next = entries.load(std::memory_order_relaxed);
+      while (!entries.compare_exchange_weak(entry->next, entry, std::memory_order_release, std::memory_order_relaxed))
+         ;
+      return entry;
+   }
+
+   public:
+   /// Constructor
+   WorkerStates() = default;
+   /// Destructor
+   ~WorkerStates() {
+      clear();
+   }
+
+   WorkerStates(const WorkerStates&) = delete;
+   WorkerStates& operator=(const WorkerStates&) = delete;
+
+   /// Get the state of the current worker and construct it with the result
+   /// of construct() if the worker does not have one yet
+   template <typename LocalState, typename F>
+   T& get(LocalState& localState, F&& construct) {
+      auto*& cachedEntry = reinterpret_cast<Entry*&>(localState.data);
+      if (cachedEntry)
+         return cachedEntry->state;
+
+#ifdef UDO_STANDALONE
+      auto workerId = getWorkerId();
+      if (workerId < workerEntries.size()) {
+         auto*& workerEntry = workerEntries[workerId];
+         if (!workerEntry)
+            workerEntry = addEntry(construct);
+         cachedEntry = workerEntry;
+         return cachedEntry->state;
+      }
+#endif
+
+      cachedEntry = addEntry(construct);
+      return cachedEntry->state;
+   }
+
+   /// Get the state of the current worker and default-construct it if the
+   /// worker does not have one yet
+   template <typename LocalState>
+   T& get(LocalState& localState) {
+      return get(localState, [] { return T(); });
+   }
+
+   /// Call a function for the states of all workers. Must not run
+   /// concurrently to get() or clear().
+   template <typename F>
+   void forEach(F&& function) {
+      for (auto* entry = entries.load(std::memory_order_acquire); entry; entry = entry->next)
+         function(entry->state);
+   }
+
+   /// Destroy the states of all workers. Must not run concurrently to get()
+   /// or forEach(). Workers must not use the states they got before.
+   void clear() {
+      for (auto* entry = entries.exchange(nullptr); entry;) {
+         std::unique_ptr<Entry> entryPtr(entry);
+         entry = entry->next;
+      }
+#ifdef UDO_STANDALONE
+      workerEntries.fill(nullptr);
+#endif
+   }
+};
+//---------------------------------------------------------------------------
+}
+//---------------------------------------------------------------------------
+#endif